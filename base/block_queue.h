@@ -1,22 +1,66 @@
 #ifndef __BLOCK_QUEUE_H__
 #define __BLOCK_QUEUE_H__
 
-#include <queue>
+#include <stdint.h>
+#include <algorithm>
+#include <deque>
+#include <vector>
 #include <mutex>
+#include <chrono>
 #include <condition_variable>
 
 namespace cube {
 
+// blocking queue for multiple producers and consumers.
+// when capacity > 0, producers block while the queue is full.
 template<typename T>
 class BlockQueue {
     public:
-        void Push(const T &task);
+        // capacity 0 means unbounded
+        explicit BlockQueue(size_t capacity = 0)
+            : m_capacity(capacity), m_push_waiters(0), m_pop_waiters(0) {}
+
+        // block while the queue is full
+        void Push(const T &item);
+        void Push(T &&item);
+        // return false when the queue is full
+        bool TryPush(const T &item);
+        bool TryPush(T &&item);
+
+        // block while the queue is empty
         T Pop();
+        // wait at most timeout_ms for an item, 0 means no wait,
+        // return false when timed out
+        bool TryPop(T &item, int64_t timeout_ms = 0);
+
+        // block while the queue is empty, then append all items to items,
+        // return the number of items
+        size_t PopAll(std::vector<T> &items);
+        // same as PopAll but at most max items
+        size_t PopBatch(std::vector<T> &items, size_t max);
+
+        size_t Size();
+        size_t Capacity() const { return m_capacity; }
+
+    private:
+        bool Full() const { return m_capacity > 0 && m_queue.size() >= m_capacity; }
+
+        template<typename U>
+        void PushItem(U &&item);
+        template<typename U>
+        bool TryPushItem(U &&item);
+
+        void WaitNotEmpty(std::unique_lock<std::mutex> &lock);
+        void NotifyNotFull(size_t num);
 
     private:
-        std::queue<T> m_queue;
+        size_t m_capacity;
+        std::deque<T> m_queue;
         std::mutex m_queue_mutex;
-        std::condition_variable m_queue_cv;
+        std::condition_variable m_not_empty;
+        std::condition_variable m_not_full;
+        size_t m_push_waiters;
+        size_t m_pop_waiters;
 
     private:
         BlockQueue(const BlockQueue &) = delete;
@@ -26,21 +70,133 @@ class BlockQueue {
 };
 
 template<typename T>
-void BlockQueue<T>::Push(const T &task) {
+void BlockQueue<T>::Push(const T &item) {
+    PushItem(item);
+}
+
+template<typename T>
+void BlockQueue<T>::Push(T &&item) {
+    PushItem(std::move(item));
+}
+
+template<typename T>
+bool BlockQueue<T>::TryPush(const T &item) {
+    return TryPushItem(item);
+}
+
+template<typename T>
+bool BlockQueue<T>::TryPush(T &&item) {
+    return TryPushItem(std::move(item));
+}
+
+template<typename T>
+template<typename U>
+void BlockQueue<T>::PushItem(U &&item) {
+    std::unique_lock<std::mutex> lock(m_queue_mutex);
+    while (Full()) {
+        m_push_waiters++;
+        m_not_full.wait(lock);
+        m_push_waiters--;
+    }
+    m_queue.push_back(std::forward<U>(item));
+    if (m_pop_waiters > 0)
+        m_not_empty.notify_one();
+}
+
+template<typename T>
+template<typename U>
+bool BlockQueue<T>::TryPushItem(U &&item) {
     std::unique_lock<std::mutex> lock(m_queue_mutex);
-    bool empty = m_queue.empty();
-    m_queue.push(task);
-    if (empty)
-        m_queue_cv.notify_all();
+    if (Full())
+        return false;
+    m_queue.push_back(std::forward<U>(item));
+    if (m_pop_waiters > 0)
+        m_not_empty.notify_one();
+    return true;
+}
+
+template<typename T>
+void BlockQueue<T>::WaitNotEmpty(std::unique_lock<std::mutex> &lock) {
+    while (m_queue.empty()) {
+        m_pop_waiters++;
+        m_not_empty.wait(lock);
+        m_pop_waiters--;
+    }
+}
+
+template<typename T>
+void BlockQueue<T>::NotifyNotFull(size_t num) {
+    if (m_push_waiters == 0)
+        return;
+    if (num == 1) m_not_full.notify_one();
+    else m_not_full.notify_all();
 }
 
 template<typename T>
 T BlockQueue<T>::Pop() {
     std::unique_lock<std::mutex> lock(m_queue_mutex);
-    while (m_queue.empty()) m_queue_cv.wait(lock);
-    T task = m_queue.front();
-    m_queue.pop();
-    return task;
+    WaitNotEmpty(lock);
+    T item(std::move(m_queue.front()));
+    m_queue.pop_front();
+    NotifyNotFull(1);
+    return item;
+}
+
+template<typename T>
+bool BlockQueue<T>::TryPop(T &item, int64_t timeout_ms) {
+    std::unique_lock<std::mutex> lock(m_queue_mutex);
+    if (m_queue.empty() && timeout_ms > 0) {
+        std::chrono::steady_clock::time_point deadline =
+            std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+        m_pop_waiters++;
+        while (m_queue.empty()
+                && m_not_empty.wait_until(lock, deadline) != std::cv_status::timeout);
+        m_pop_waiters--;
+    }
+    if (m_queue.empty())
+        return false;
+    item = std::move(m_queue.front());
+    m_queue.pop_front();
+    NotifyNotFull(1);
+    return true;
+}
+
+template<typename T>
+size_t BlockQueue<T>::PopAll(std::vector<T> &items) {
+    std::unique_lock<std::mutex> lock(m_queue_mutex);
+    WaitNotEmpty(lock);
+    size_t num = m_queue.size();
+    items.reserve(items.size() + num);
+    for (size_t i = 0; i < num; i++)
+        items.push_back(std::move(m_queue[i]));
+    m_queue.clear();
+    NotifyNotFull(num);
+    return num;
+}
+
+template<typename T>
+size_t BlockQueue<T>::PopBatch(std::vector<T> &items, size_t max) {
+    if (max == 0)
+        return 0;
+    std::unique_lock<std::mutex> lock(m_queue_mutex);
+    WaitNotEmpty(lock);
+    size_t num = std::min(max, m_queue.size());
+    items.reserve(items.size() + num);
+    for (size_t i = 0; i < num; i++) {
+        items.push_back(std::move(m_queue.front()));
+        m_queue.pop_front();
+    }
+    NotifyNotFull(num);
+    // more items for other consumers
+    if (!m_queue.empty() && m_pop_waiters > 0)
+        m_not_empty.notify_one();
+    return num;
+}
+
+template<typename T>
+size_t BlockQueue<T>::Size() {
+    std::unique_lock<std::mutex> lock(m_queue_mutex);
+    return m_queue.size();
 }
 
 }
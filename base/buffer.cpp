@@ -1,3 +1,5 @@
+#include <endian.h>
+#include <string.h>
 #include <sys/uio.h>
 #include <algorithm>
 
@@ -6,6 +8,65 @@
 namespace cube {
 
 const char *Buffer::CRLF = "\r\n";
+const size_t Buffer::CHEAP_PREPEND;
+const size_t Buffer::INITIAL_SIZE;
+const size_t Buffer::KEEP_ALL;
+
+Buffer::Buffer()
+    : buffer(NULL), capacity(0), read_index(0), write_index(0),
+    pool(NULL), from_pool(false), keep_capacity(KEEP_ALL) {
+}
+
+Buffer::Buffer(SlabPool *slab_pool)
+    : buffer(NULL), capacity(0), read_index(0), write_index(0),
+    pool(slab_pool), from_pool(false), keep_capacity(KEEP_ALL) {
+}
+
+Buffer::~Buffer() {
+    FreeStorage();
+}
+
+void Buffer::MakeSpace(size_t n) {
+    if (WritableBytes() >= n) {
+        return;
+    } else if (Cap() >= CHEAP_PREPEND + ReadableBytes() + n) {
+        // move readable data to the front, read_index > CHEAP_PREPEND here
+        size_t readable = ReadableBytes();
+        std::copy(BeginRead(), BeginWrite(), Begin() + CHEAP_PREPEND);
+        read_index = CHEAP_PREPEND;
+        write_index = read_index + readable;
+    } else {
+        // grow at least twice, so appending many pieces
+        // copies the data only a few times
+        size_t readable = ReadableBytes();
+        size_t size = std::max(std::max(CHEAP_PREPEND + readable + n, Cap() * 2), INITIAL_SIZE);
+        char *b = NULL;
+        bool slab = pool != NULL && size <= pool->SlabSize();
+        if (slab) {
+            size = pool->SlabSize();
+            b = pool->Allocate();
+        } else {
+            b = new char[size];
+        }
+        std::copy(BeginRead(), BeginWrite(), b + CHEAP_PREPEND);
+        FreeStorage();
+        buffer = b;
+        capacity = size;
+        from_pool = slab;
+        read_index = CHEAP_PREPEND;
+        write_index = read_index + readable;
+    }
+}
+
+void Buffer::FreeStorage() {
+    if (buffer == NULL)
+        return;
+    if (from_pool) pool->Free(buffer);
+    else delete[] buffer;
+    buffer = NULL;
+    capacity = 0;
+    from_pool = false;
+}
 
 void Buffer::Append(const std::string &str) {
     Append(str.data(), str.length());
@@ -18,6 +79,74 @@ void Buffer::Append(const char *data, size_t len) {
     write_index += len;
 }
 
+void Buffer::Prepend(const char *data, size_t len) {
+    if (PrependableBytes() < len) {
+        // rare, move readable data back by len
+        MakeSpace(len);
+        std::copy_backward(BeginRead(), BeginWrite(), BeginWrite() + len);
+        read_index += len;
+        write_index += len;
+    }
+    read_index -= len;
+    std::copy(data, data + len, BeginRead());
+}
+
+void Buffer::AppendInt16(int16_t x) {
+    uint16_t be = htobe16(static_cast<uint16_t>(x));
+    Append(reinterpret_cast<const char *>(&be), sizeof(be));
+}
+
+void Buffer::AppendInt32(int32_t x) {
+    uint32_t be = htobe32(static_cast<uint32_t>(x));
+    Append(reinterpret_cast<const char *>(&be), sizeof(be));
+}
+
+void Buffer::AppendInt64(int64_t x) {
+    uint64_t be = htobe64(static_cast<uint64_t>(x));
+    Append(reinterpret_cast<const char *>(&be), sizeof(be));
+}
+
+void Buffer::PrependInt16(int16_t x) {
+    uint16_t be = htobe16(static_cast<uint16_t>(x));
+    Prepend(reinterpret_cast<const char *>(&be), sizeof(be));
+}
+
+void Buffer::PrependInt32(int32_t x) {
+    uint32_t be = htobe32(static_cast<uint32_t>(x));
+    Prepend(reinterpret_cast<const char *>(&be), sizeof(be));
+}
+
+void Buffer::PrependInt64(int64_t x) {
+    uint64_t be = htobe64(static_cast<uint64_t>(x));
+    Prepend(reinterpret_cast<const char *>(&be), sizeof(be));
+}
+
+int8_t Buffer::PeekInt8() {
+    assert(ReadableBytes() >= sizeof(int8_t));
+    return static_cast<int8_t>(*BeginRead());
+}
+
+int16_t Buffer::PeekInt16() {
+    assert(ReadableBytes() >= sizeof(int16_t));
+    uint16_t be;
+    memcpy(&be, BeginRead(), sizeof(be));
+    return static_cast<int16_t>(be16toh(be));
+}
+
+int32_t Buffer::PeekInt32() {
+    assert(ReadableBytes() >= sizeof(int32_t));
+    uint32_t be;
+    memcpy(&be, BeginRead(), sizeof(be));
+    return static_cast<int32_t>(be32toh(be));
+}
+
+int64_t Buffer::PeekInt64() {
+    assert(ReadableBytes() >= sizeof(int64_t));
+    uint64_t be;
+    memcpy(&be, BeginRead(), sizeof(be));
+    return static_cast<int64_t>(be64toh(be));
+}
+
 const char *Buffer::FindCRLF() {
     return Find(CRLF, CRLF + 2);
 }
@@ -34,19 +163,34 @@ const char *Buffer::Find(const std::string &delimiter) {
 const char *Buffer::FindFrom(const char *from, const char *begin, const char *end) {
     assert(from >= BeginRead());
     assert(from <= BeginWrite());
-    const char *found = std::search(from, (const char *)BeginWrite(), begin, end);
-    if (found == BeginWrite())
-        return NULL;
-    return found;
+    assert(begin < end);
+    // memchr the first byte, then compare the rest.
+    // memchr skips bytes in vector steps of libc,
+    // about 2x faster than std::search on http headers
+    size_t len = end - begin;
+    const char *last = BeginWrite();
+    while (static_cast<size_t>(last - from) >= len) {
+        const char *found = static_cast<const char *>(memchr(from, *begin, last - from - len + 1));
+        if (found == NULL)
+            return NULL;
+        if (memcmp(found + 1, begin + 1, len - 1) == 0)
+            return found;
+        from = found + 1;
+    }
+    return NULL;
 }
 
 ssize_t Buffer::ReadFromFd(int fd) {
-    struct iovec iov[2];
     char buf[32 * 1024];
+    return ReadFromFd(fd, buf, sizeof(buf));
+}
+
+ssize_t Buffer::ReadFromFd(int fd, char *overflow, size_t overflow_len) {
+    struct iovec iov[2];
     iov[0].iov_base = BeginWrite();
     iov[0].iov_len = WritableBytes();
-    iov[1].iov_base = buf;
-    iov[1].iov_len = sizeof(buf);
+    iov[1].iov_base = overflow;
+    iov[1].iov_len = overflow_len;
     ssize_t nread = readv(fd, iov, 2);
     if (nread >= 0) {
         if ((size_t)nread <= WritableBytes()) {
@@ -54,7 +198,7 @@ ssize_t Buffer::ReadFromFd(int fd) {
         } else {
             const size_t len = nread - WritableBytes();
             write_index += WritableBytes();
-            Append(buf, len);
+            Append(overflow, len);
         }
     } else {
         // error
@@ -64,8 +208,12 @@ ssize_t Buffer::ReadFromFd(int fd) {
 
 void Buffer::Swap(Buffer &rhs) {
     std::swap(buffer, rhs.buffer);
+    std::swap(capacity, rhs.capacity);
     std::swap(read_index, rhs.read_index);
     std::swap(write_index, rhs.write_index);
+    std::swap(pool, rhs.pool);
+    std::swap(from_pool, rhs.from_pool);
+    std::swap(keep_capacity, rhs.keep_capacity);
 }
 
 }
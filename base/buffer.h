@@ -5,17 +5,61 @@
 #include <vector>
 #include <string>
 #include <assert.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "slab_pool.h"
 
 namespace cube {
 
+// contiguous buffer, storage is allocated on first write.
+// with a SlabPool, storage not larger than a slab is a slab of the pool,
+// and the buffer must be used in the thread of the pool.
+// pointers returned by Peek and Find are invalid after Retrieve.
+//
+// +-------------------+------------------+------------------+
+// | prependable bytes |  readable bytes  |  writable bytes  |
+// +-------------------+------------------+------------------+
+// 0              read_index         write_index        capacity
+//
+// CHEAP_PREPEND bytes before the data are kept free when storage is
+// allocated or drained, e.g. for a length header written after the body.
 class Buffer {
     public:
+        static const size_t CHEAP_PREPEND = 8;
         static const size_t INITIAL_SIZE = 1024;        // 1K
+        // never free storage when drained
+        static const size_t KEEP_ALL = (size_t)-1;
 
-        Buffer() : buffer(INITIAL_SIZE), read_index(0), write_index(0) { }
+        Buffer();
+        explicit Buffer(SlabPool *slab_pool);
+        ~Buffer();
 
         void Append(const std::string &str);
         void Append(const char *data, size_t len);
+        // put data before the readable bytes, data is moved
+        // only when len > PrependableBytes()
+        void Prepend(const char *data, size_t len);
+
+        // integers in network byte order
+        void AppendInt8(int8_t x) { Append(reinterpret_cast<const char *>(&x), sizeof(x)); }
+        void AppendInt16(int16_t x);
+        void AppendInt32(int32_t x);
+        void AppendInt64(int64_t x);
+        void PrependInt8(int8_t x) { Prepend(reinterpret_cast<const char *>(&x), sizeof(x)); }
+        void PrependInt16(int16_t x);
+        void PrependInt32(int32_t x);
+        void PrependInt64(int64_t x);
+        // readable bytes must be enough
+        int8_t PeekInt8();
+        int16_t PeekInt16();
+        int32_t PeekInt32();
+        int64_t PeekInt64();
+        // peek and retrieve
+        int8_t ReadInt8() { int8_t x = PeekInt8(); Retrieve(sizeof(x)); return x; }
+        int16_t ReadInt16() { int16_t x = PeekInt16(); Retrieve(sizeof(x)); return x; }
+        int32_t ReadInt32() { int32_t x = PeekInt32(); Retrieve(sizeof(x)); return x; }
+        int64_t ReadInt64() { int64_t x = PeekInt64(); Retrieve(sizeof(x)); return x; }
 
         const char *Peek() { return BeginRead(); }
 
@@ -27,6 +71,8 @@ class Buffer {
         void Retrieve(size_t n) {
             assert(ReadableBytes() >= n);
             read_index += n;
+            if (read_index == write_index)
+                RetrieveAll();
         }
 
         void RetrieveUntil(const char *end) {
@@ -42,22 +88,45 @@ class Buffer {
         }
 
         void RetrieveAll() {
-            read_index = 0;
-            write_index = 0;
+            if (capacity > keep_capacity)
+                FreeStorage();
+            ResetIndex();
         }
 
         size_t ReadableBytes() const { return write_index - read_index; }
         size_t WritableBytes() const { return Cap() - write_index; }
-        size_t Cap() const { return buffer.size(); }
+        size_t PrependableBytes() const { return read_index; }
+        size_t Cap() const { return capacity; }
+
+        // shrink policy after bursts: when the buffer is drained and its
+        // capacity is larger than keep_capacity, the storage is freed.
+        // 0 frees it on every drain, so an idle buffer holds no memory.
+        // KEEP_ALL by default
+        void SetKeepCapacity(size_t bytes) { keep_capacity = bytes; }
+        size_t KeepCapacity() const { return keep_capacity; }
+
+        // free the storage, readable data is dropped
+        void Release() {
+            FreeStorage();
+            ResetIndex();
+        }
 
+        // make sure n bytes can be written without growing
+        void EnsureWritableBytes(size_t n) { MakeSpace(n); }
+
+        // read into the writable space, the rest that does not fit goes
+        // to a 32K stack buffer and then is appended
         ssize_t ReadFromFd(int fd);
+        // same, but the rest goes to overflow, e.g. a region shared by
+        // all buffers of a thread, see EventLoop::GetReadOverflow
+        ssize_t ReadFromFd(int fd, char *overflow, size_t overflow_len);
 
         void Swap(Buffer &rhs);
 
     private:
         static const char *CRLF;
 
-        char *Begin() { return &*buffer.begin(); }
+        char *Begin() { return buffer; }
 
         char *BeginRead() { return Begin() + read_index; }
 
@@ -66,32 +135,32 @@ class Buffer {
         // MakeSpace(n) to guarantee space for another n bytes.
         // After MakeSpace(n), at least n bytes can be written to the
         // buffer without another allocation.
-        void MakeSpace(size_t n) {
-            if (WritableBytes() >= n) {
-                return;
-            } else if (buffer.size() - ReadableBytes() >= n) {
-                size_t readable = ReadableBytes();
-                std::copy(BeginRead(), BeginWrite(), Begin()); 
-                read_index = 0;
-                write_index = read_index + readable;
-            } else {
-                size_t readable = ReadableBytes();
-                std::vector<char> b(readable + n);
-                std::copy(BeginRead(), BeginWrite(), b.data());
-                std::swap(buffer, b);
-                read_index = 0;
-                write_index = read_index + readable;
-            }
+        void MakeSpace(size_t n);
+
+        void FreeStorage();
+
+        // no prepend space without storage
+        void ResetIndex() {
+            read_index = buffer != NULL ? CHEAP_PREPEND : 0;
+            write_index = read_index;
         }
 
     private:
-        // TODO use char * instead of std::vector
-        std::vector<char> buffer;
+        // noncopyable
+        Buffer(const Buffer &) = delete;
+        Buffer &operator=(const Buffer &) = delete;
+
+    private:
+        char *buffer;
+        size_t capacity;
         size_t read_index;
         size_t write_index;
+        // storage is a slab of pool when from_pool
+        SlabPool *pool;
+        bool from_pool;
+        size_t keep_capacity;
 };
 
 }
 
 #endif
-
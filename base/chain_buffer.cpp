@@ -0,0 +1,184 @@
+#include <assert.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include "chain_buffer.h"
+
+namespace cube {
+
+const int ChainBuffer::DEFAULT_IOVECS;
+const int ChainBuffer::MAX_IOVECS;
+const int ChainBuffer::READ_SLABS;
+const int ChainBuffer::MAX_READ_SLABS;
+
+ChainBuffer::ChainBuffer(SlabPool *pool)
+    : m_pool(pool), m_head(0), m_readable(0) {
+}
+
+ChainBuffer::~ChainBuffer() {
+    RetrieveAll();
+}
+
+void ChainBuffer::AppendSlab() {
+    Slab slab;
+    slab.data = m_pool->Allocate();
+    slab.read_index = 0;
+    slab.write_index = 0;
+    PushSlab(slab);
+}
+
+void ChainBuffer::PushSlab(const Slab &slab) {
+    // drop popped slabs once they are half of the vector,
+    // so a chain that never drains does not grow forever
+    if (m_head > 0 && m_head * 2 >= m_slabs.size()) {
+        m_slabs.erase(m_slabs.begin(), m_slabs.begin() + m_head);
+        m_head = 0;
+    }
+    m_slabs.push_back(slab);
+}
+
+void ChainBuffer::PopSlab() {
+    Slab &slab = m_slabs[m_head];
+    if (slab.slice.Empty())
+        m_pool->Free(slab.data);
+    else
+        slab.slice = SharedSlice();
+    if (++m_head == m_slabs.size()) {
+        m_slabs.clear();
+        m_head = 0;
+    }
+}
+
+void ChainBuffer::Append(const std::string &str) {
+    Append(str.data(), str.length());
+}
+
+void ChainBuffer::Append(const char *data, size_t len) {
+    const size_t slab_size = m_pool->SlabSize();
+    while (len > 0) {
+        if (!LastSlabWritable())
+            AppendSlab();
+        Slab &slab = m_slabs.back();
+        size_t n = std::min(len, slab_size - slab.write_index);
+        memcpy(slab.data + slab.write_index, data, n);
+        slab.write_index += n;
+        m_readable += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void ChainBuffer::Append(const SharedSlice &slice) {
+    if (slice.Empty())
+        return;
+    Slab slab;
+    slab.data = const_cast<char *>(slice.Data());
+    slab.read_index = 0;
+    slab.write_index = slice.Size();
+    slab.slice = slice;
+    PushSlab(slab);
+    m_readable += slice.Size();
+}
+
+void ChainBuffer::Retrieve(size_t n) {
+    assert(m_readable >= n);
+    m_readable -= n;
+    while (n > 0) {
+        Slab &slab = m_slabs[m_head];
+        size_t readable = slab.write_index - slab.read_index;
+        if (n < readable) {
+            slab.read_index += n;
+            return;
+        }
+        n -= readable;
+        PopSlab();
+    }
+    // drained, give back all slabs
+    if (m_readable == 0)
+        RetrieveAll();
+}
+
+void ChainBuffer::RetrieveAll() {
+    while (m_slabs.size() > m_head)
+        PopSlab();
+    // give back the vector too, an idle chain holds no memory
+    std::vector<Slab>().swap(m_slabs);
+    m_readable = 0;
+}
+
+void ChainBuffer::RetrieveAllTo(Buffer *buffer) {
+    buffer->EnsureWritableBytes(m_readable);
+    for (size_t i = m_head; i < m_slabs.size(); i++) {
+        const Slab &slab = m_slabs[i];
+        buffer->Append(slab.data + slab.read_index, slab.write_index - slab.read_index);
+    }
+    RetrieveAll();
+}
+
+int ChainBuffer::PeekIovecs(struct iovec *iov, int max, size_t max_bytes) const {
+    int num = 0;
+    for (size_t i = m_head; i < m_slabs.size() && num < max && max_bytes > 0; i++) {
+        const Slab &slab = m_slabs[i];
+        if (slab.write_index == slab.read_index)
+            continue;
+        iov[num].iov_base = slab.data + slab.read_index;
+        iov[num].iov_len = std::min(slab.write_index - slab.read_index, max_bytes);
+        max_bytes -= iov[num].iov_len;
+        num++;
+    }
+    return num;
+}
+
+ssize_t ChainBuffer::ReadFromFd(int fd, int slabs) {
+    assert(slabs > 0 && slabs <= MAX_READ_SLABS);
+    const size_t slab_size = m_pool->SlabSize();
+    // free space of the last slab, then fresh slabs.
+    // counted from m_head, which AppendSlab may move
+    size_t first = Slabs();
+    if (LastSlabWritable())
+        first--;
+    for (int i = 0; i < slabs; i++)
+        AppendSlab();
+
+    struct iovec iov[MAX_READ_SLABS + 1];
+    int iovcnt = 0;
+    for (size_t i = m_head + first; i < m_slabs.size(); i++) {
+        Slab &slab = m_slabs[i];
+        iov[iovcnt].iov_base = slab.data + slab.write_index;
+        iov[iovcnt].iov_len = slab_size - slab.write_index;
+        iovcnt++;
+    }
+
+    ssize_t nread = readv(fd, iov, iovcnt);
+    size_t left = nread > 0 ? nread : 0;
+    m_readable += left;
+    for (size_t i = m_head + first; i < m_slabs.size() && left > 0; i++) {
+        Slab &slab = m_slabs[i];
+        size_t n = std::min(left, slab_size - slab.write_index);
+        slab.write_index += n;
+        left -= n;
+    }
+    // give back the slabs not filled
+    while (m_slabs.size() > m_head && m_slabs.back().write_index == 0) {
+        m_pool->Free(m_slabs.back().data);
+        m_slabs.pop_back();
+    }
+    if (m_readable == 0)
+        RetrieveAll();
+    return nread;
+}
+
+ssize_t ChainBuffer::WriteToFd(int fd, int max_iovecs, size_t max_bytes) {
+    struct iovec iov[MAX_IOVECS];
+    int iovcnt = PeekIovecs(iov, std::max(1, std::min(max_iovecs, MAX_IOVECS)), max_bytes);
+    if (iovcnt == 0)
+        return 0;
+    ssize_t nwrote = iovcnt == 1 ? ::write(fd, iov[0].iov_base, iov[0].iov_len)
+        : writev(fd, iov, iovcnt);
+    if (nwrote > 0)
+        Retrieve(nwrote);
+    return nwrote;
+}
+
+}
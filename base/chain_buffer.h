@@ -0,0 +1,98 @@
+#ifndef __CUBE_CHAIN_BUFFER_H__
+#define __CUBE_CHAIN_BUFFER_H__
+
+#include <sys/types.h>
+#include <sys/uio.h>
+#include <string>
+#include <vector>
+
+#include "buffer.h"
+#include "shared_slice.h"
+#include "slab_pool.h"
+
+namespace cube {
+
+// Buffer made of a chain of slabs from a SlabPool.
+// growing never moves or copies the data already buffered,
+// and slabs go back to the pool as soon as they are drained.
+// SharedSlices are chained as they are, without copying.
+// reads and writes of fds use readv/writev over the chain.
+// use RetrieveAllTo() when a parser needs a flat view.
+// an empty chain holds no memory, so idle owners cost nothing.
+class ChainBuffer {
+    public:
+        // iovecs per writev by default
+        static const int DEFAULT_IOVECS = 64;
+        // iovecs per writev at most, IOV_MAX of linux
+        static const int MAX_IOVECS = 1024;
+        // new slabs a read may fill, by default and at most
+        static const int READ_SLABS = 4;
+        static const int MAX_READ_SLABS = 64;
+
+        explicit ChainBuffer(SlabPool *pool);
+        ~ChainBuffer();
+
+        void Append(const std::string &str);
+        void Append(const char *data, size_t len);
+        // chain the slice, the data is not copied
+        void Append(const SharedSlice &slice);
+
+        size_t ReadableBytes() const { return m_readable; }
+        // slabs and slices held
+        size_t Slabs() const { return m_slabs.size() - m_head; }
+
+        void Retrieve(size_t n);
+        // free all slabs
+        void RetrieveAll();
+        // move all readable data to the end of buffer, which grows once,
+        // e.g. a large message read in slabs is copied only when complete
+        void RetrieveAllTo(Buffer *buffer);
+
+        // fill at most max iovecs with at most max_bytes of readable data,
+        // return the number of them
+        int PeekIovecs(struct iovec *iov, int max, size_t max_bytes = (size_t)-1) const;
+
+        // readv into the free space of the last slab and at most
+        // slabs new slabs, slabs <= MAX_READ_SLABS
+        ssize_t ReadFromFd(int fd, int slabs = READ_SLABS);
+        // writev at most max_bytes of readable data in at most max_iovecs
+        // pieces, and retrieve what is written
+        ssize_t WriteToFd(int fd, int max_iovecs = DEFAULT_IOVECS,
+                size_t max_bytes = (size_t)-1);
+
+    private:
+        // a slab of the pool, or a slice when slice is not empty
+        struct Slab {
+            char *data;
+            size_t read_index;
+            size_t write_index;
+            SharedSlice slice;
+        };
+
+        // whether data can be appended to the last slab
+        bool LastSlabWritable() const {
+            return m_slabs.size() > m_head && m_slabs.back().slice.Empty()
+                && m_slabs.back().write_index < m_pool->SlabSize();
+        }
+
+        void AppendSlab();
+        void PushSlab(const Slab &slab);
+        void PopSlab();
+
+    private:
+        // noncopyable
+        ChainBuffer(const ChainBuffer &) = delete;
+        ChainBuffer &operator=(const ChainBuffer &) = delete;
+
+    private:
+        SlabPool *m_pool;
+        // slabs before m_head are popped, a vector allocates nothing
+        // until the first slab, unlike a deque
+        std::vector<Slab> m_slabs;
+        size_t m_head;
+        size_t m_readable;
+};
+
+}
+
+#endif
@@ -32,8 +32,8 @@ class CountDowner {
 
     private:
         int m_count;
-        std::mutex m_count_mutex;
-        std::condition_variable m_count_cv;
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
 };
 
 }
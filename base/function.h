@@ -0,0 +1,192 @@
+#ifndef __CUBE_FUNCTION_H__
+#define __CUBE_FUNCTION_H__
+
+#include <stddef.h>
+#include <new>
+#include <utility>
+#include <functional>
+#include <type_traits>
+
+namespace cube {
+
+template<typename Signature, size_t Capacity = 48>
+class Function;
+
+// move-only replacement of std::function,
+// callables not larger than Capacity are stored inline without allocation.
+// the default capacity holds a bind of a member function, a shared_ptr
+// and a few more arguments.
+template<typename R, typename... Args, size_t Capacity>
+class Function<R(Args...), Capacity> {
+    public:
+        Function() : m_ops(NULL) {}
+        Function(std::nullptr_t) : m_ops(NULL) {}
+
+        template<typename F,
+            typename = typename std::enable_if<
+                !std::is_same<typename std::decay<F>::type, Function>::value>::type>
+        Function(F &&f) : m_ops(NULL) {
+            Init(std::forward<F>(f));
+        }
+
+        Function(Function &&other) noexcept : m_ops(NULL) {
+            MoveFrom(other);
+        }
+
+        ~Function() { Reset(); }
+
+        Function &operator=(Function &&other) noexcept {
+            if (this != &other) {
+                Reset();
+                MoveFrom(other);
+            }
+            return *this;
+        }
+
+        Function &operator=(std::nullptr_t) {
+            Reset();
+            return *this;
+        }
+
+        template<typename F,
+            typename = typename std::enable_if<
+                !std::is_same<typename std::decay<F>::type, Function>::value>::type>
+        Function &operator=(F &&f) {
+            Reset();
+            Init(std::forward<F>(f));
+            return *this;
+        }
+
+        void swap(Function &other) {
+            Function tmp(std::move(other));
+            other = std::move(*this);
+            *this = std::move(tmp);
+        }
+
+        explicit operator bool() const { return m_ops != NULL; }
+
+        R operator()(Args... args) const {
+            return m_ops->invoke(&m_storage, std::forward<Args>(args)...);
+        }
+
+        // whether F is stored without allocation
+        template<typename F>
+        static bool IsInline() { return Inline<F>::value; }
+
+    private:
+        // noncopyable
+        Function(const Function &) = delete;
+        Function &operator=(const Function &) = delete;
+
+    private:
+        typedef typename std::aligned_storage<Capacity>::type Storage;
+
+        struct Ops {
+            R (*invoke)(void *storage, Args &&...args);
+            // move callable from one storage to another, and destroy the source
+            void (*move)(void *from, void *to);
+            void (*destroy)(void *storage);
+        };
+
+        template<typename F>
+        struct Inline {
+            static const bool value = sizeof(F) <= sizeof(Storage)
+                && std::alignment_of<F>::value <= std::alignment_of<Storage>::value
+                && std::is_nothrow_move_constructible<F>::value;
+        };
+
+        // callable is stored in storage
+        template<typename F>
+        struct InlineOps {
+            static R Invoke(void *storage, Args &&...args) {
+                return (*static_cast<F *>(storage))(std::forward<Args>(args)...);
+            }
+            static void Move(void *from, void *to) {
+                new (to) F(std::move(*static_cast<F *>(from)));
+                static_cast<F *>(from)->~F();
+            }
+            static void Destroy(void *storage) {
+                static_cast<F *>(storage)->~F();
+            }
+            static const Ops ops;
+        };
+
+        // pointer to callable is stored in storage
+        template<typename F>
+        struct HeapOps {
+            static F *&Ptr(void *storage) { return *static_cast<F **>(storage); }
+            static R Invoke(void *storage, Args &&...args) {
+                return (*Ptr(storage))(std::forward<Args>(args)...);
+            }
+            static void Move(void *from, void *to) {
+                Ptr(to) = Ptr(from);
+            }
+            static void Destroy(void *storage) {
+                delete Ptr(storage);
+            }
+            static const Ops ops;
+        };
+
+        template<typename F>
+        static bool IsNull(const F &) { return false; }
+        template<typename T>
+        static bool IsNull(T *f) { return f == NULL; }
+        template<typename T, typename C>
+        static bool IsNull(T C::*f) { return f == NULL; }
+        template<typename S>
+        static bool IsNull(const std::function<S> &f) { return !f; }
+        template<typename S, size_t N>
+        static bool IsNull(const Function<S, N> &f) { return !f; }
+
+        template<typename F>
+        void Init(F &&f) {
+            typedef typename std::decay<F>::type Callable;
+            if (IsNull(f))
+                return;
+            if (Inline<Callable>::value) {
+                new (&m_storage) Callable(std::forward<F>(f));
+                m_ops = &InlineOps<Callable>::ops;
+            } else {
+                HeapOps<Callable>::Ptr(&m_storage) = new Callable(std::forward<F>(f));
+                m_ops = &HeapOps<Callable>::ops;
+            }
+        }
+
+        void MoveFrom(Function &other) {
+            if (other.m_ops) {
+                other.m_ops->move(&other.m_storage, &m_storage);
+                m_ops = other.m_ops;
+                other.m_ops = NULL;
+            }
+        }
+
+        void Reset() {
+            if (m_ops) {
+                const Ops *ops = m_ops;
+                m_ops = NULL;
+                ops->destroy(&m_storage);
+            }
+        }
+
+    private:
+        mutable Storage m_storage;
+        const Ops *m_ops;
+};
+
+template<typename R, typename... Args, size_t Capacity>
+template<typename F>
+const typename Function<R(Args...), Capacity>::Ops
+Function<R(Args...), Capacity>::InlineOps<F>::ops = {
+    &InlineOps<F>::Invoke, &InlineOps<F>::Move, &InlineOps<F>::Destroy
+};
+
+template<typename R, typename... Args, size_t Capacity>
+template<typename F>
+const typename Function<R(Args...), Capacity>::Ops
+Function<R(Args...), Capacity>::HeapOps<F>::ops = {
+    &HeapOps<F>::Invoke, &HeapOps<F>::Move, &HeapOps<F>::Destroy
+};
+
+}
+
+#endif
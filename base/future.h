@@ -0,0 +1,439 @@
+#ifndef __CUBE_FUTURE_H__
+#define __CUBE_FUTURE_H__
+
+#include <assert.h>
+#include <stddef.h>
+#include <new>
+#include <utility>
+#include <vector>
+#include <type_traits>
+
+#include "function.h"
+
+namespace cube {
+
+// Single-threaded future and promise for the callbacks of one loop.
+// a promise, its future and all continuations must be used in the same
+// thread (usually a loop thread), so there is no lock or atomic operation.
+// a future has one consumer: Then() or Get() takes the value away.
+// a promise dropped without a value never fulfils its future,
+// the continuations waiting on it are destroyed with it.
+
+template<typename T>
+class Future;
+
+template<typename T>
+class Promise;
+
+namespace detail {
+
+// freed blocks of Size bytes, reused in the same thread,
+// most futures live shorter than a request
+template<size_t Size>
+class BlockCache {
+    public:
+        static const size_t MAX_CACHED_BLOCKS = 4096;
+
+        BlockCache() : m_head(NULL), m_count(0) {}
+        ~BlockCache() {
+            while (m_head) {
+                Node *node = m_head;
+                m_head = node->next;
+                ::operator delete(node);
+            }
+        }
+
+        void *Allocate() {
+            if (m_head == NULL)
+                return ::operator new(Size);
+            Node *node = m_head;
+            m_head = node->next;
+            m_count--;
+            return node;
+        }
+
+        void Free(void *ptr) {
+            if (m_count >= MAX_CACHED_BLOCKS) {
+                ::operator delete(ptr);
+                return;
+            }
+            Node *node = static_cast<Node *>(ptr);
+            node->next = m_head;
+            m_head = node;
+            m_count++;
+        }
+
+        static BlockCache &Instance() {
+            static thread_local BlockCache cache;
+            return cache;
+        }
+
+    private:
+        struct Node {
+            Node *next;
+        };
+
+        Node *m_head;
+        size_t m_count;
+};
+
+// state shared by a promise and its future
+template<typename T>
+class FutureState {
+    public:
+        typedef Function<void(T &&)> Callback;
+
+        static void *operator new(size_t size) {
+            return BlockCache<sizeof(FutureState)>::Instance().Allocate();
+        }
+        static void operator delete(void *ptr) {
+            BlockCache<sizeof(FutureState)>::Instance().Free(ptr);
+        }
+
+        FutureState() : m_refs(1), m_ready(false) {}
+        ~FutureState() {
+            if (m_ready)
+                Value().~T();
+        }
+
+        void AddRef() { m_refs++; }
+        void Release() {
+            if (--m_refs == 0)
+                delete this;
+        }
+
+        bool Ready() const { return m_ready; }
+        T &Value() { return *reinterpret_cast<T *>(&m_storage); }
+
+        template<typename U>
+        void SetValue(U &&value) {
+            assert(!m_ready);
+            new (&m_storage) T(std::forward<U>(value));
+            m_ready = true;
+            if (m_callback) {
+                Callback callback(std::move(m_callback));
+                callback(std::move(Value()));
+            }
+        }
+
+        // call at once if the value is set
+        void SetCallback(Callback callback) {
+            assert(!m_callback);
+            if (m_ready) callback(std::move(Value()));
+            else m_callback = std::move(callback);
+        }
+
+    private:
+        FutureState(const FutureState &) = delete;
+        FutureState &operator=(const FutureState &) = delete;
+
+    private:
+        int m_refs;
+        bool m_ready;
+        typename std::aligned_storage<sizeof(T), std::alignment_of<T>::value>::type m_storage;
+        Callback m_callback;
+};
+
+template<typename R>
+struct ThenHelper;
+
+}
+
+template<typename T>
+class Promise {
+    public:
+        Promise() : m_state(new detail::FutureState<T>()) {}
+        // copies share the state, it is set once by any of them.
+        // copyable so that it can be bound into a std::function
+        Promise(const Promise &other) : m_state(other.m_state) {
+            if (m_state) m_state->AddRef();
+        }
+        Promise(Promise &&other) noexcept : m_state(other.m_state) { other.m_state = NULL; }
+        ~Promise() {
+            if (m_state) m_state->Release();
+        }
+
+        Promise &operator=(Promise other) {
+            std::swap(m_state, other.m_state);
+            return *this;
+        }
+
+        // the future of this promise, call it once
+        Future<T> GetFuture() {
+            m_state->AddRef();
+            return Future<T>(m_state);
+        }
+
+        // run the continuation in place
+        void SetValue(const T &value) { m_state->SetValue(value); }
+        void SetValue(T &&value) { m_state->SetValue(std::move(value)); }
+
+    private:
+        detail::FutureState<T> *m_state;
+};
+
+template<typename T>
+class Future {
+    public:
+        typedef T ValueType;
+
+        Future() : m_state(NULL) {}
+        Future(Future &&other) noexcept : m_state(other.m_state) { other.m_state = NULL; }
+        ~Future() { Reset(); }
+
+        Future &operator=(Future &&other) noexcept {
+            if (this != &other) {
+                Reset();
+                m_state = other.m_state;
+                other.m_state = NULL;
+            }
+            return *this;
+        }
+
+        // false after the value is taken
+        bool Valid() const { return m_state != NULL; }
+        bool Ready() const { return m_state && m_state->Ready(); }
+
+        // take the value of a ready future
+        T Get() {
+            assert(Ready());
+            T value(std::move(m_state->Value()));
+            Reset();
+            return value;
+        }
+
+        // call f(T) when the value is set, at once if it is ready.
+        // if f returns void, return void;
+        // if f returns Future<U>, return Future<U> fulfilled by that future;
+        // otherwise return Future of the result of f.
+        template<typename F>
+        typename detail::ThenHelper<
+            typename std::result_of<typename std::decay<F>::type(T &&)>::type>::Type
+        Then(F &&f) {
+            typedef typename std::result_of<typename std::decay<F>::type(T &&)>::type R;
+            assert(m_state);
+            detail::FutureState<T> *state = m_state;
+            m_state = NULL;
+            return detail::ThenHelper<R>::Chain(state, std::forward<F>(f));
+        }
+
+    private:
+        friend class Promise<T>;
+        explicit Future(detail::FutureState<T> *state) : m_state(state) {}
+
+        void Reset() {
+            if (m_state) {
+                m_state->Release();
+                m_state = NULL;
+            }
+        }
+
+    private:
+        // noncopyable
+        Future(const Future &) = delete;
+        Future &operator=(const Future &) = delete;
+
+    private:
+        detail::FutureState<T> *m_state;
+};
+
+template<typename T>
+Future<typename std::decay<T>::type> MakeReadyFuture(T &&value) {
+    Promise<typename std::decay<T>::type> promise;
+    promise.SetValue(std::forward<T>(value));
+    return promise.GetFuture();
+}
+
+namespace detail {
+
+// set the promise with the value of another future
+template<typename T>
+class ForwardValue {
+    public:
+        explicit ForwardValue(Promise<T> &&promise) : m_promise(std::move(promise)) {}
+        ForwardValue(ForwardValue &&other) noexcept : m_promise(std::move(other.m_promise)) {}
+        void operator()(T &&value) { m_promise.SetValue(std::move(value)); }
+
+    private:
+        Promise<T> m_promise;
+};
+
+// the future releases its reference after the callback is set,
+// the state is owned by the promise from then on
+template<typename T, typename F>
+void SetCallback(FutureState<T> *state, F &&f) {
+    state->SetCallback(std::forward<F>(f));
+    state->Release();
+}
+
+template<typename T, typename R, typename F>
+class ValueContinuation {
+    public:
+        ValueContinuation(Promise<R> &&promise, F &&f)
+            : m_promise(std::move(promise)), m_f(std::move(f)) {}
+        ValueContinuation(ValueContinuation &&other) noexcept
+            : m_promise(std::move(other.m_promise)), m_f(std::move(other.m_f)) {}
+        void operator()(T &&value) { m_promise.SetValue(m_f(std::move(value))); }
+
+    private:
+        Promise<R> m_promise;
+        F m_f;
+};
+
+template<typename T, typename U, typename F>
+class FutureContinuation {
+    public:
+        FutureContinuation(Promise<U> &&promise, F &&f)
+            : m_promise(std::move(promise)), m_f(std::move(f)) {}
+        FutureContinuation(FutureContinuation &&other) noexcept
+            : m_promise(std::move(other.m_promise)), m_f(std::move(other.m_f)) {}
+        void operator()(T &&value) {
+            m_f(std::move(value)).Then(ForwardValue<U>(std::move(m_promise)));
+        }
+
+    private:
+        Promise<U> m_promise;
+        F m_f;
+};
+
+template<typename R>
+struct ThenHelper {
+    typedef Future<R> Type;
+
+    template<typename T, typename F>
+    static Type Chain(FutureState<T> *state, F &&f) {
+        typedef typename std::decay<F>::type Func;
+        Promise<R> promise;
+        Type future = promise.GetFuture();
+        SetCallback(state, ValueContinuation<T, R, Func>(std::move(promise), Func(std::forward<F>(f))));
+        return future;
+    }
+};
+
+template<typename U>
+struct ThenHelper<Future<U> > {
+    typedef Future<U> Type;
+
+    template<typename T, typename F>
+    static Type Chain(FutureState<T> *state, F &&f) {
+        typedef typename std::decay<F>::type Func;
+        Promise<U> promise;
+        Type future = promise.GetFuture();
+        SetCallback(state, FutureContinuation<T, U, Func>(std::move(promise), Func(std::forward<F>(f))));
+        return future;
+    }
+};
+
+template<>
+struct ThenHelper<void> {
+    typedef void Type;
+
+    template<typename T, typename F>
+    static void Chain(FutureState<T> *state, F &&f) {
+        SetCallback(state, std::forward<F>(f));
+    }
+};
+
+// join of WhenAll, owned by the callbacks of the input futures,
+// freed when the last callback is gone
+template<typename T>
+class AllJoin {
+    public:
+        explicit AllJoin(size_t num) : m_refs(num), m_pending(num), m_values(num) {}
+
+        Future<std::vector<T> > GetFuture() { return m_promise.GetFuture(); }
+
+        void SetValue(size_t idx, T &&value) {
+            m_values[idx] = std::move(value);
+            if (--m_pending == 0)
+                m_promise.SetValue(std::move(m_values));
+        }
+        void Release() {
+            if (--m_refs == 0)
+                delete this;
+        }
+
+    private:
+        size_t m_refs;
+        size_t m_pending;
+        std::vector<T> m_values;
+        Promise<std::vector<T> > m_promise;
+};
+
+// join of WhenAny, the first value wins
+template<typename T>
+class AnyJoin {
+    public:
+        explicit AnyJoin(size_t num) : m_refs(num), m_done(false) {}
+
+        Future<std::pair<size_t, T> > GetFuture() { return m_promise.GetFuture(); }
+
+        void SetValue(size_t idx, T &&value) {
+            if (m_done)
+                return;
+            m_done = true;
+            m_promise.SetValue(std::pair<size_t, T>(idx, std::move(value)));
+        }
+        void Release() {
+            if (--m_refs == 0)
+                delete this;
+        }
+
+    private:
+        size_t m_refs;
+        bool m_done;
+        Promise<std::pair<size_t, T> > m_promise;
+};
+
+template<typename Join, typename T>
+class JoinCallback {
+    public:
+        JoinCallback(Join *join, size_t idx) : m_join(join), m_idx(idx) {}
+        JoinCallback(JoinCallback &&other) noexcept : m_join(other.m_join), m_idx(other.m_idx) {
+            other.m_join = NULL;
+        }
+        ~JoinCallback() {
+            if (m_join) m_join->Release();
+        }
+        void operator()(T &&value) { m_join->SetValue(m_idx, std::move(value)); }
+
+    private:
+        JoinCallback(const JoinCallback &) = delete;
+        JoinCallback &operator=(const JoinCallback &) = delete;
+
+    private:
+        Join *m_join;
+        size_t m_idx;
+};
+
+}
+
+// fulfilled with all values, in the order of futures, when all are set.
+// the values of futures are taken
+// T must be default constructible and move assignable
+template<typename T>
+Future<std::vector<T> > WhenAll(std::vector<Future<T> > &futures) {
+    if (futures.empty())
+        return MakeReadyFuture(std::vector<T>());
+    detail::AllJoin<T> *join = new detail::AllJoin<T>(futures.size());
+    Future<std::vector<T> > future = join->GetFuture();
+    for (size_t i = 0; i < futures.size(); i++)
+        futures[i].Then(detail::JoinCallback<detail::AllJoin<T>, T>(join, i));
+    return future;
+}
+
+// fulfilled with the index and the value of the first future set,
+// the values of futures are taken, futures must not be empty
+template<typename T>
+Future<std::pair<size_t, T> > WhenAny(std::vector<Future<T> > &futures) {
+    assert(!futures.empty());
+    detail::AnyJoin<T> *join = new detail::AnyJoin<T>(futures.size());
+    Future<std::pair<size_t, T> > future = join->GetFuture();
+    for (size_t i = 0; i < futures.size(); i++)
+        futures[i].Then(detail::JoinCallback<detail::AnyJoin<T>, T>(join, i));
+    return future;
+}
+
+}
+
+#endif
@@ -0,0 +1,93 @@
+#ifndef __CUBE_MPSC_QUEUE_H__
+#define __CUBE_MPSC_QUEUE_H__
+
+#include <atomic>
+#include <utility>
+#include <vector>
+
+namespace cube {
+
+// Lock-free multi-producer single-consumer queue.
+// Producers push onto an atomic list head,
+// the consumer takes the whole list at once and restores FIFO order.
+template<typename T>
+class MpscQueue {
+    public:
+        MpscQueue() : m_head(NULL) {}
+        ~MpscQueue();
+
+        // thread-safety
+        // return true when the queue was empty before pushing
+        bool Push(const T &item) { return PushNode(new Node(item)); }
+        bool Push(T &&item) { return PushNode(new Node(std::move(item))); }
+
+        // only for consumer
+        // append all items to items in FIFO order, return the number of items
+        size_t PopAll(std::vector<T> &items);
+
+        bool Empty() const { return m_head.load(std::memory_order_acquire) == NULL; }
+
+    private:
+        struct Node {
+            Node(const T &v) : value(v), next(NULL) {}
+            Node(T &&v) : value(std::move(v)), next(NULL) {}
+            T value;
+            Node *next;
+        };
+
+        bool PushNode(Node *node);
+
+    private:
+        std::atomic<Node *> m_head;
+
+    private:
+        MpscQueue(const MpscQueue &) = delete;
+        MpscQueue &operator=(const MpscQueue &) = delete;
+};
+
+template<typename T>
+MpscQueue<T>::~MpscQueue() {
+    Node *node = m_head.exchange(NULL);
+    while (node) {
+        Node *next = node->next;
+        delete node;
+        node = next;
+    }
+}
+
+template<typename T>
+bool MpscQueue<T>::PushNode(Node *node) {
+    node->next = m_head.load(std::memory_order_relaxed);
+    while (!m_head.compare_exchange_weak(node->next, node,
+                std::memory_order_release, std::memory_order_relaxed));
+    return node->next == NULL;
+}
+
+template<typename T>
+size_t MpscQueue<T>::PopAll(std::vector<T> &items) {
+    Node *node = m_head.exchange(NULL, std::memory_order_acquire);
+
+    // reverse to FIFO order
+    Node *first = NULL;
+    size_t num = 0;
+    while (node) {
+        Node *next = node->next;
+        node->next = first;
+        first = node;
+        node = next;
+        num++;
+    }
+
+    items.reserve(items.size() + num);
+    while (first) {
+        Node *next = first->next;
+        items.push_back(std::move(first->value));
+        delete first;
+        first = next;
+    }
+    return num;
+}
+
+}
+
+#endif
@@ -0,0 +1,47 @@
+#ifndef __CUBE_SHARED_SLICE_H__
+#define __CUBE_SHARED_SLICE_H__
+
+#include <assert.h>
+#include <stddef.h>
+#include <memory>
+#include <string>
+
+namespace cube {
+
+// immutable bytes shared without copying, e.g. a cached response
+// or a broadcast message written to thousands of connections.
+// copies refer to the same data, the reference count is atomic,
+// so a slice may be shared by connections of different loops.
+class SharedSlice {
+    public:
+        SharedSlice() : m_offset(0), m_len(0) {}
+        explicit SharedSlice(std::string data)
+            : m_data(std::make_shared<const std::string>(std::move(data))),
+            m_offset(0), m_len(m_data->size()) {}
+        SharedSlice(const char *data, size_t len)
+            : m_data(std::make_shared<const std::string>(data, len)),
+            m_offset(0), m_len(len) {}
+
+        const char *Data() const { return m_data ? m_data->data() + m_offset : NULL; }
+        size_t Size() const { return m_len; }
+        bool Empty() const { return m_len == 0; }
+
+        // part of this slice, sharing the data
+        SharedSlice Sub(size_t offset, size_t len) const {
+            assert(offset + len <= m_len);
+            return SharedSlice(m_data, m_offset + offset, len);
+        }
+
+    private:
+        SharedSlice(const std::shared_ptr<const std::string> &data, size_t offset, size_t len)
+            : m_data(data), m_offset(offset), m_len(len) {}
+
+    private:
+        std::shared_ptr<const std::string> m_data;
+        size_t m_offset;
+        size_t m_len;
+};
+
+}
+
+#endif
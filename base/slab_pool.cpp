@@ -0,0 +1,48 @@
+#include <assert.h>
+
+#include "slab_pool.h"
+
+namespace cube {
+
+const size_t SlabPool::DEFAULT_SLAB_SIZE;
+const size_t SlabPool::DEFAULT_MAX_FREE_SLABS;
+
+SlabPool::SlabPool(size_t slab_size, size_t max_free_slabs)
+    : m_slab_size(slab_size),
+    m_max_free_slabs(max_free_slabs),
+    m_used_slabs(0) {
+}
+
+SlabPool::~SlabPool() {
+    for (size_t i = 0; i < m_free_slabs.size(); i++)
+        delete[] m_free_slabs[i];
+}
+
+char *SlabPool::Allocate() {
+    m_used_slabs++;
+    if (m_free_slabs.empty())
+        return new char[m_slab_size];
+    char *slab = m_free_slabs.back();
+    m_free_slabs.pop_back();
+    return slab;
+}
+
+void SlabPool::Free(char *slab) {
+    assert(m_used_slabs > 0);
+    m_used_slabs--;
+    if (m_free_slabs.size() >= m_max_free_slabs) {
+        delete[] slab;
+        return;
+    }
+    m_free_slabs.push_back(slab);
+}
+
+void SlabPool::SetMaxFreeSlabs(size_t max_free_slabs) {
+    m_max_free_slabs = max_free_slabs;
+    while (m_free_slabs.size() > m_max_free_slabs) {
+        delete[] m_free_slabs.back();
+        m_free_slabs.pop_back();
+    }
+}
+
+}
@@ -0,0 +1,50 @@
+#ifndef __CUBE_SLAB_POOL_H__
+#define __CUBE_SLAB_POOL_H__
+
+#include <stddef.h>
+#include <vector>
+
+namespace cube {
+
+// fixed-size memory blocks for buffers, one pool per loop.
+// not thread-safe, slabs are allocated and freed in the loop thread.
+// freed slabs are cached for reuse, at most max_free_slabs of them.
+// buffers must give back their slabs before the pool goes away.
+class SlabPool {
+    public:
+        static const size_t DEFAULT_SLAB_SIZE = 16 * 1024;       // 16K
+        static const size_t DEFAULT_MAX_FREE_SLABS = 256;        // 4M cached
+
+        explicit SlabPool(size_t slab_size = DEFAULT_SLAB_SIZE,
+                size_t max_free_slabs = DEFAULT_MAX_FREE_SLABS);
+        ~SlabPool();
+
+        char *Allocate();
+        void Free(char *slab);
+
+        size_t SlabSize() const { return m_slab_size; }
+
+        // free cached slabs beyond max_free_slabs at once
+        void SetMaxFreeSlabs(size_t max_free_slabs);
+        size_t MaxFreeSlabs() const { return m_max_free_slabs; }
+
+        // slabs cached in pool
+        size_t FreeSlabs() const { return m_free_slabs.size(); }
+        // slabs held by buffers
+        size_t UsedSlabs() const { return m_used_slabs; }
+
+    private:
+        // noncopyable
+        SlabPool(const SlabPool &) = delete;
+        SlabPool &operator=(const SlabPool &) = delete;
+
+    private:
+        const size_t m_slab_size;
+        size_t m_max_free_slabs;
+        size_t m_used_slabs;
+        std::vector<char *> m_free_slabs;
+};
+
+}
+
+#endif
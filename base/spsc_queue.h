@@ -0,0 +1,117 @@
+#ifndef __CUBE_SPSC_QUEUE_H__
+#define __CUBE_SPSC_QUEUE_H__
+
+#include <stddef.h>
+#include <atomic>
+#include <utility>
+#include <vector>
+
+namespace cube {
+
+// Lock-free single-producer single-consumer ring buffer,
+// the bounded counterpart of BlockQueue for pipeline stages.
+// it never blocks, the caller decides how to wait when full or empty.
+template<typename T>
+class SpscQueue {
+    public:
+        // capacity is rounded up to a power of 2
+        explicit SpscQueue(size_t capacity);
+
+        // only for producer
+        // return false when the queue is full
+        bool TryPush(const T &item) { return PushItem(item); }
+        bool TryPush(T &&item) { return PushItem(std::move(item)); }
+
+        // only for consumer
+        // return false when the queue is empty
+        bool TryPop(T &item);
+        // append at most max items to items, return the number of items
+        size_t PopBatch(std::vector<T> &items, size_t max);
+
+        bool Empty() const {
+            return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+        }
+        size_t Capacity() const { return m_mask + 1; }
+
+    private:
+        static size_t RoundUp(size_t n) {
+            size_t size = 1;
+            while (size < n) size <<= 1;
+            return size;
+        }
+
+        template<typename U>
+        bool PushItem(U &&item);
+
+    private:
+        const size_t m_mask;
+        std::vector<T> m_items;
+        // producer and consumer indexes on their own cache lines,
+        // each side caches the other's index to touch it less often
+        char m_pad0[64];
+        std::atomic<size_t> m_tail;     // next slot to push
+        size_t m_cached_head;
+        char m_pad1[64];
+        std::atomic<size_t> m_head;     // next slot to pop
+        size_t m_cached_tail;
+        char m_pad2[64];
+
+    private:
+        SpscQueue(const SpscQueue &) = delete;
+        SpscQueue &operator=(const SpscQueue &) = delete;
+};
+
+template<typename T>
+SpscQueue<T>::SpscQueue(size_t capacity)
+    : m_mask(RoundUp(capacity) - 1),
+    m_items(m_mask + 1),
+    m_tail(0),
+    m_cached_head(0),
+    m_head(0),
+    m_cached_tail(0) {
+}
+
+template<typename T>
+template<typename U>
+bool SpscQueue<T>::PushItem(U &&item) {
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    if (tail - m_cached_head > m_mask) {
+        m_cached_head = m_head.load(std::memory_order_acquire);
+        if (tail - m_cached_head > m_mask)
+            return false;
+    }
+    m_items[tail & m_mask] = std::forward<U>(item);
+    m_tail.store(tail + 1, std::memory_order_release);
+    return true;
+}
+
+template<typename T>
+bool SpscQueue<T>::TryPop(T &item) {
+    size_t head = m_head.load(std::memory_order_relaxed);
+    if (head == m_cached_tail) {
+        m_cached_tail = m_tail.load(std::memory_order_acquire);
+        if (head == m_cached_tail)
+            return false;
+    }
+    item = std::move(m_items[head & m_mask]);
+    m_head.store(head + 1, std::memory_order_release);
+    return true;
+}
+
+template<typename T>
+size_t SpscQueue<T>::PopBatch(std::vector<T> &items, size_t max) {
+    size_t head = m_head.load(std::memory_order_relaxed);
+    if (m_cached_tail - head < max)
+        m_cached_tail = m_tail.load(std::memory_order_acquire);
+    size_t num = m_cached_tail - head;
+    if (num > max) num = max;
+    for (size_t i = 0; i < num; i++)
+        items.push_back(std::move(m_items[(head + i) & m_mask]));
+    // release all slots at once
+    m_head.store(head + num, std::memory_order_release);
+    return num;
+}
+
+}
+
+#endif
@@ -0,0 +1,174 @@
+#include <assert.h>
+#include <string.h>
+#include <algorithm>
+
+#include "time_util.h"
+#include "thread_pool.h"
+
+namespace cube {
+
+const size_t ThreadPool::DEFAULT_QUEUE_CAPACITY;
+const size_t ThreadPool::MAX_BATCH;
+const size_t ThreadPool::INITIAL_RING_SIZE;
+
+ThreadPool::ThreadPool(size_t thread_num, size_t queue_capacity)
+    : m_thread_num(thread_num),
+    m_started(false),
+    m_stopping(false),
+    m_items(std::min(queue_capacity, INITIAL_RING_SIZE)),
+    m_capacity(queue_capacity),
+    m_head(0),
+    m_size(0),
+    m_full_waiters(0) {
+    assert(thread_num > 0);
+    assert(queue_capacity > 0);
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+
+ThreadPool::~ThreadPool() {
+    if (m_started)
+        Stop();
+}
+
+void ThreadPool::Start() {
+    assert(!m_started);
+    m_started = true;
+    m_stopping = false;
+    for (size_t i = 0; i < m_thread_num; i++) {
+        m_threads.push_back(std::unique_ptr<std::thread>(new std::thread(
+                        std::bind(&ThreadPool::ThreadFunc, this))));
+    }
+}
+
+void ThreadPool::Stop() {
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        m_not_empty.notify_all();
+        m_not_full.notify_all();
+    }
+    for (size_t i = 0; i < m_threads.size(); i++)
+        m_threads[i]->join();
+    m_threads.clear();
+    m_started = false;
+}
+
+bool ThreadPool::Submit(Task task) {
+    Task completion;
+    return Push(task, completion, NULL, NULL, true);
+}
+
+bool ThreadPool::TrySubmit(Task task) {
+    Task completion;
+    return Push(task, completion, NULL, NULL, false);
+}
+
+bool ThreadPool::Push(Task &task, Task &completion, PostFunc post, void *loop, bool block) {
+    int64_t now_us = TimeUtil::MonotonicMicros();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (!m_stopping && m_size == m_capacity) {
+        if (!block) {
+            m_stats.rejected++;
+            return false;
+        }
+        m_full_waiters++;
+        m_not_full.wait(lock);
+        m_full_waiters--;
+    }
+    if (m_stopping)
+        return false;
+    if (m_size == m_items.size())
+        Grow();
+
+    Item &item = m_items[(m_head + m_size) % m_items.size()];
+    item.task = std::move(task);
+    item.completion = std::move(completion);
+    item.post = post;
+    item.loop = loop;
+    item.enqueue_us = now_us;
+    m_size++;
+
+    m_stats.submitted++;
+    if (m_size > m_stats.max_queue_depth)
+        m_stats.max_queue_depth = m_size;
+
+    m_not_empty.notify_one();
+    return true;
+}
+
+void ThreadPool::Grow() {
+    std::vector<Item> items(std::min(m_items.size() * 2, m_capacity));
+    for (size_t i = 0; i < m_size; i++)
+        items[i] = std::move(m_items[(m_head + i) % m_items.size()]);
+    m_items.swap(items);
+    m_head = 0;
+}
+
+void ThreadPool::ThreadFunc() {
+    std::vector<Item> batch;
+    batch.reserve(MAX_BATCH);
+
+    // stats of the last batch, merged when taking the lock next time
+    uint64_t completed = 0;
+    int64_t run_us = 0;
+    int64_t max_run_us = 0;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_stats.completed += completed;
+            m_stats.run_us += run_us;
+            m_stats.max_run_us = std::max(m_stats.max_run_us, max_run_us);
+            completed = run_us = max_run_us = 0;
+
+            while (m_size == 0 && !m_stopping)
+                m_not_empty.wait(lock);
+            // run out the queue before exit
+            if (m_size == 0)
+                break;
+
+            // take a fair share, leave the rest to other workers
+            size_t num = std::min(MAX_BATCH, std::max<size_t>(1, m_size / m_thread_num));
+            int64_t now_us = TimeUtil::MonotonicMicros();
+            for (size_t i = 0; i < num; i++) {
+                Item &item = m_items[m_head];
+                int64_t wait_us = now_us - item.enqueue_us;
+                m_stats.wait_us += wait_us;
+                m_stats.max_wait_us = std::max(m_stats.max_wait_us, wait_us);
+                batch.push_back(std::move(item));
+                m_head = (m_head + 1) % m_items.size();
+                m_size--;
+            }
+
+            if (m_full_waiters > 0) {
+                if (num == 1) m_not_full.notify_one();
+                else m_not_full.notify_all();
+            }
+            if (m_size > 0)
+                m_not_empty.notify_one();
+        }
+
+        for (size_t i = 0; i < batch.size(); i++) {
+            Item &item = batch[i];
+            int64_t begin_us = TimeUtil::MonotonicMicros();
+            item.task();
+            int64_t cost_us = TimeUtil::MonotonicMicros() - begin_us;
+            run_us += cost_us;
+            max_run_us = std::max(max_run_us, cost_us);
+            completed++;
+            if (item.post)
+                item.post(item.loop, item.completion);
+        }
+        batch.clear();
+    }
+}
+
+ThreadPoolStats ThreadPool::GetStats() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    ThreadPoolStats stats = m_stats;
+    stats.queue_depth = m_size;
+    return stats;
+}
+
+}
@@ -0,0 +1,116 @@
+#ifndef __CUBE_THREAD_POOL_H__
+#define __CUBE_THREAD_POOL_H__
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "function.h"
+
+namespace cube {
+
+// all times are in us
+struct ThreadPoolStats {
+    size_t queue_depth;         // tasks waiting in queue now
+    size_t max_queue_depth;
+    uint64_t submitted;
+    uint64_t rejected;          // TrySubmit on a full queue
+    uint64_t completed;
+    int64_t wait_us;            // total time tasks waited in queue
+    int64_t max_wait_us;
+    int64_t run_us;             // total time running tasks
+    int64_t max_run_us;
+};
+
+// worker threads for cpu heavy tasks, with a bounded queue.
+// workers pop tasks in batches to take the lock less often.
+class ThreadPool {
+    public:
+        typedef Function<void(), 88> Task;
+
+        static const size_t DEFAULT_QUEUE_CAPACITY = 65536;
+        static const size_t MAX_BATCH = 16;
+        // slots of the ring at start, doubled up to queue capacity when full
+        static const size_t INITIAL_RING_SIZE = 64;
+
+        ThreadPool(size_t thread_num, size_t queue_capacity = DEFAULT_QUEUE_CAPACITY);
+        ~ThreadPool();
+
+        void Start();
+        // tasks in queue are run before workers exit
+        void Stop();
+
+        // block while the queue is full,
+        // return false when stopped
+        bool Submit(Task task);
+        // return false when the queue is full or stopped
+        bool TrySubmit(Task task);
+
+        // run task in pool, then post completion to the loop,
+        // which is any type with Post(Task), e.g. net::EventLoop
+        template<typename Loop>
+        bool Submit(Task task, Loop *loop, Task completion) {
+            return Push(task, completion, &PostTo<Loop>, loop, true);
+        }
+        template<typename Loop>
+        bool TrySubmit(Task task, Loop *loop, Task completion) {
+            return Push(task, completion, &PostTo<Loop>, loop, false);
+        }
+
+        size_t ThreadNum() const { return m_thread_num; }
+        ThreadPoolStats GetStats();
+
+    private:
+        typedef void (*PostFunc)(void *loop, Task &completion);
+
+        struct Item {
+            Task task;
+            Task completion;
+            PostFunc post;
+            void *loop;
+            int64_t enqueue_us;
+        };
+
+        template<typename Loop>
+        static void PostTo(void *loop, Task &completion) {
+            static_cast<Loop *>(loop)->Post(std::move(completion));
+        }
+
+        bool Push(Task &task, Task &completion, PostFunc post, void *loop, bool block);
+        // double the ring, lock held
+        void Grow();
+
+        void ThreadFunc();
+
+    private:
+        // noncopyable
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+    private:
+        size_t m_thread_num;
+        std::vector<std::unique_ptr<std::thread>> m_threads;
+        bool m_started;
+        bool m_stopping;
+
+        // ring buffer of at most m_capacity items, grown on demand
+        // so that an idle pool holds little memory
+        std::vector<Item> m_items;
+        size_t m_capacity;
+        size_t m_head;
+        size_t m_size;
+
+        std::mutex m_mutex;
+        std::condition_variable m_not_empty;
+        std::condition_variable m_not_full;
+        size_t m_full_waiters;
+
+        ThreadPoolStats m_stats;
+};
+
+}
+
+#endif
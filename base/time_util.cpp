@@ -1,6 +1,7 @@
 #include "time_util.h"
 
 #include <sys/time.h>
+#include <time.h>
 
 namespace cube {
 
@@ -16,4 +17,33 @@ int64_t TimeUtil::CurrentTimeMillis() {
     return res;
 }
 
+int64_t TimeUtil::CurrentTimeMicros() {
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return static_cast<int64_t>(tv.tv_sec) * 1000 * 1000 +
+        static_cast<int64_t>(tv.tv_usec);
+}
+
+static int64_t ClockMicros(clockid_t clock_id) {
+    struct timespec ts;
+    clock_gettime(clock_id, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000 * 1000 +
+        static_cast<int64_t>(ts.tv_nsec) / 1000;
+}
+
+int64_t TimeUtil::MonotonicMicros() {
+    return ClockMicros(CLOCK_MONOTONIC);
+}
+
+int64_t TimeUtil::CoarseMonotonicMicros() {
+    return ClockMicros(CLOCK_MONOTONIC_COARSE);
+}
+
+int64_t TimeUtil::CoarseMonotonicResolution() {
+    struct timespec ts;
+    clock_getres(CLOCK_MONOTONIC_COARSE, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000 * 1000 +
+        static_cast<int64_t>(ts.tv_nsec) / 1000;
+}
+
 }
@@ -15,6 +15,18 @@ class TimeUtil {
         // get current time in ms
         static int64_t CurrentTimeMillis();
 
+        // get current time in us
+        static int64_t CurrentTimeMicros();
+
+        // get monotonic time in us, not affected by clock adjustments
+        static int64_t MonotonicMicros();
+
+        // get monotonic time in us with jiffy resolution,
+        // cheaper than MonotonicMicros()
+        static int64_t CoarseMonotonicMicros();
+        // resolution of CoarseMonotonicMicros() in us
+        static int64_t CoarseMonotonicResolution();
+
 };
 
 }
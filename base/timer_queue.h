@@ -1,46 +1,43 @@
 #ifndef __CUBE_TIMER_QUEUE_H__
 #define __CUBE_TIMER_QUEUE_H__
 
-#include <set>
-#include <map>
+#include <stddef.h>
 #include <cstdint>
-#include <functional>
+
+#include "function.h"
 
 namespace cube {
 
 typedef uint64_t TimerId;
-typedef std::function<void()> TimerTask;
-
-struct Timer {
-    TimerId timer_id;
-    TimerTask task;
-    int64_t expiration_ms;   
-    int64_t interval_ms;
-    bool operator<(const Timer &rhs) const {
-        if (expiration_ms != rhs.expiration_ms)
-            return expiration_ms < rhs.expiration_ms;
-        return timer_id < rhs.timer_id;
-    }
-};
+// large enough to hold a bind of a callback with its arguments
+typedef Function<void(), 88> TimerTask;
 
+// interface of timer queues, all times are in us
 class TimerQueue {
     public:
-        TimerId AddTimer(const TimerTask &task, int64_t expiration_ms, int64_t interval_ms);
-        void RemoveTimer(TimerId timer_id);
+        enum Type {
+            Type_Tree,      // ordered set, exact expiration, O(log n)
+            Type_Wheel,     // hierarchical timing wheel, tick resolution, O(1)
+        };
 
-        // next_expiration == -1 when no timers
-        int Expire(int64_t now_ms, int64_t &next_expiration);
+        // now_us is the current time of the clock timers are measured in
+        static TimerQueue *Create(Type type, int64_t now_us);
 
-    private:
-        static TimerId NextTimerId();
+        virtual ~TimerQueue() {}
 
-        static TimerId m_next_timer_id;  // atomic
+        virtual Type GetType() const = 0;
+
+        virtual TimerId AddTimer(TimerTask task, int64_t expiration_us, int64_t interval_us) = 0;
+        virtual void RemoveTimer(TimerId timer_id) = 0;
+
+        // run expired timers
+        // next_expiration == -1 when no timers
+        virtual int Expire(int64_t now_us, int64_t &next_expiration) = 0;
 
-        void AddTimer(const Timer &timer);
+        // when Expire should be called next, as next_expiration of Expire
+        virtual int64_t NextExpiration(int64_t now_us) const = 0;
 
-    private:
-        std::set<Timer> m_timers;
-        std::map<TimerId, int64_t> m_timer_expiration;
+        virtual size_t Size() const = 0;
 };
 
 }
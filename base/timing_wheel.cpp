@@ -0,0 +1,241 @@
+#include <assert.h>
+#include <algorithm>
+
+#include "timing_wheel.h"
+
+namespace cube {
+
+const int64_t TimingWheel::DEFAULT_TICK_US;
+const uint32_t TimingWheel::NIL;
+const uint16_t TimingWheel::NO_LIST;
+
+TimingWheel::TimingWheel(int64_t now_us, int64_t tick_us)
+    : m_tick_us(tick_us),
+    m_current(now_us / tick_us),
+    m_nodes(LIST_NUM),
+    m_free(NIL),
+    m_size(0),
+    m_root_size(0) {
+    assert(tick_us > 0);
+    for (uint32_t i = 0; i < LIST_NUM; i++) {
+        m_nodes[i].prev = m_nodes[i].next = i;
+        m_nodes[i].list = i;
+    }
+}
+
+uint32_t TimingWheel::AllocNode() {
+    uint32_t idx = m_free;
+    if (idx != NIL) {
+        m_free = m_nodes[idx].next;
+    } else {
+        idx = m_nodes.size();
+        m_nodes.push_back(Node());
+        m_nodes[idx].gen = 1;
+    }
+    m_nodes[idx].list = NO_LIST;
+    m_size++;
+    return idx;
+}
+
+void TimingWheel::FreeNode(uint32_t idx) {
+    Node &node = m_nodes[idx];
+    node.task = nullptr;
+    node.gen++;
+    node.list = NO_LIST;
+    node.next = m_free;
+    m_free = idx;
+    m_size--;
+}
+
+void TimingWheel::Link(int list, uint32_t idx) {
+    Node &head = m_nodes[list];
+    Node &node = m_nodes[idx];
+    node.prev = head.prev;
+    node.next = list;
+    node.list = list;
+    m_nodes[head.prev].next = idx;
+    head.prev = idx;
+    if (list < ROOT_SIZE) m_root_size++;
+}
+
+void TimingWheel::Unlink(uint32_t idx) {
+    Node &node = m_nodes[idx];
+    m_nodes[node.prev].next = node.next;
+    m_nodes[node.next].prev = node.prev;
+    if (node.list < ROOT_SIZE) m_root_size--;
+    node.list = NO_LIST;
+}
+
+void TimingWheel::Splice(int from, int to) {
+    assert(ListEmpty(to));
+    if (ListEmpty(from))
+        return;
+    Node &src = m_nodes[from];
+    Node &dst = m_nodes[to];
+    dst.next = src.next;
+    dst.prev = src.prev;
+    m_nodes[dst.next].prev = to;
+    m_nodes[dst.prev].next = to;
+    src.next = src.prev = from;
+    for (uint32_t idx = dst.next; idx != (uint32_t)to; idx = m_nodes[idx].next) {
+        if (m_nodes[idx].list < ROOT_SIZE) m_root_size--;
+        m_nodes[idx].list = to;
+    }
+}
+
+void TimingWheel::Place(uint32_t idx) {
+    // round up, so that timers never expire early
+    int64_t tick = (m_nodes[idx].expiration_us + m_tick_us - 1) / m_tick_us;
+    if (tick < m_current) {
+        Link(DUE_LIST, idx);
+        return;
+    }
+
+    int64_t delta = tick - m_current;
+    if (delta < ROOT_SIZE) {
+        Link(tick & ROOT_MASK, idx);
+        return;
+    }
+
+    // too far away, park it in the last level, it will be placed again
+    if (delta >= MAX_TICKS)
+        tick = m_current + MAX_TICKS - 1;
+
+    int level = 1;
+    while (level < LEVELS - 1 && delta >= ((int64_t)1 << LevelShift(level + 1)))
+        level++;
+    Link(LevelList(level, tick >> LevelShift(level)), idx);
+}
+
+int TimingWheel::Cascade(int level) {
+    int index = (m_current >> LevelShift(level)) & LEVEL_MASK;
+    Splice(LevelList(level, index), CASCADE_LIST);
+    while (!ListEmpty(CASCADE_LIST)) {
+        uint32_t idx = m_nodes[CASCADE_LIST].next;
+        Unlink(idx);
+        Place(idx);
+    }
+    return index;
+}
+
+int TimingWheel::RunList(int list) {
+    if (ListEmpty(list))
+        return 0;
+
+    // timers may be added or removed by tasks
+    Splice(list, RUNNING_LIST);
+    int result = 0;
+    while (!ListEmpty(RUNNING_LIST)) {
+        uint32_t idx = m_nodes[RUNNING_LIST].next;
+        Unlink(idx);
+
+        TimerTask task;
+        task.swap(m_nodes[idx].task);
+        uint32_t gen = m_nodes[idx].gen;
+        bool periodic = m_nodes[idx].interval_us > 0;
+        if (periodic) {
+            m_nodes[idx].expiration_us += m_nodes[idx].interval_us;
+            Place(idx);
+        } else {
+            FreeNode(idx);
+        }
+
+        task();
+        result++;
+
+        // give the task back unless the timer was removed by itself
+        if (periodic && m_nodes[idx].gen == gen)
+            m_nodes[idx].task.swap(task);
+    }
+    return result;
+}
+
+TimerId TimingWheel::AddTimer(TimerTask task, int64_t expiration_us, int64_t interval_us) {
+    uint32_t idx = AllocNode();
+    Node &node = m_nodes[idx];
+    node.task = std::move(task);
+    node.expiration_us = expiration_us;
+    node.interval_us = interval_us;
+    Place(idx);
+    return ((TimerId)node.gen << 32) | idx;
+}
+
+void TimingWheel::RemoveTimer(TimerId timer_id) {
+    uint32_t idx = timer_id & 0xffffffff;
+    uint32_t gen = timer_id >> 32;
+    if (idx < LIST_NUM || idx >= m_nodes.size())
+        return;
+    Node &node = m_nodes[idx];
+    if (node.gen != gen || node.list == NO_LIST)
+        return;
+    Unlink(idx);
+    FreeNode(idx);
+}
+
+int TimingWheel::Expire(int64_t now_us, int64_t &next_expiration) {
+    int64_t now_tick = now_us / m_tick_us;
+
+    // timers added after their expirations
+    int result = RunList(DUE_LIST);
+
+    while (m_current <= now_tick) {
+        if (m_size == 0) {
+            m_current = now_tick + 1;
+            break;
+        }
+
+        int index = m_current & ROOT_MASK;
+        if (index == 0) {
+            for (int level = 1; level < LEVELS; level++) {
+                if (Cascade(level) != 0)
+                    break;
+            }
+        } else if (m_root_size == 0) {
+            // nothing in level 0, skip to the next cascade
+            m_current = std::min(m_current + ROOT_SIZE - index, now_tick + 1);
+            continue;
+        }
+
+        // timers expire at the current tick after this
+        // are added to due list
+        m_current++;
+        result += RunList(index);
+    }
+
+    next_expiration = NextExpiration(now_us);
+    return result;
+}
+
+int64_t TimingWheel::NextExpiration(int64_t now_us) const {
+    if (m_size == 0)
+        return -1;
+    if (!ListEmpty(DUE_LIST))
+        return now_us;
+
+    int64_t result = -1;
+    if (m_root_size > 0) {
+        for (int64_t tick = m_current; tick < m_current + ROOT_SIZE; tick++) {
+            if (!ListEmpty(tick & ROOT_MASK)) {
+                result = tick * m_tick_us;
+                break;
+            }
+        }
+    }
+
+    // or wake up at the nearest cascade, which may be earlier
+    for (int level = 1; level < LEVELS; level++) {
+        int shift = LevelShift(level);
+        int64_t first = (m_current + ((int64_t)1 << shift) - 1) >> shift;
+        for (int64_t group = first; group < first + LEVEL_SIZE; group++) {
+            if (!ListEmpty(LevelList(level, group))) {
+                int64_t tick = group << shift;
+                if (result == -1 || tick * m_tick_us < result)
+                    result = tick * m_tick_us;
+                break;
+            }
+        }
+    }
+    return result;
+}
+
+}
@@ -0,0 +1,101 @@
+#ifndef __CUBE_TIMING_WHEEL_H__
+#define __CUBE_TIMING_WHEEL_H__
+
+#include <vector>
+
+#include "timer_queue.h"
+
+namespace cube {
+
+// hierarchical timing wheel, add/remove/expire in O(1)
+// level 0 has 256 slots of one tick, level n has 64 slots of 64^(n-1)*256 ticks,
+// timers in upper levels are cascaded down when level 0 wraps around.
+// timers expire at tick boundaries, they never run earlier
+// than their expirations but up to one tick later.
+class TimingWheel : public TimerQueue {
+    public:
+        static const int64_t DEFAULT_TICK_US = 1000;
+
+        explicit TimingWheel(int64_t now_us, int64_t tick_us = DEFAULT_TICK_US);
+
+        Type GetType() const { return Type_Wheel; }
+
+        TimerId AddTimer(TimerTask task, int64_t expiration_us, int64_t interval_us);
+        void RemoveTimer(TimerId timer_id);
+
+        int Expire(int64_t now_us, int64_t &next_expiration);
+
+        int64_t NextExpiration(int64_t now_us) const;
+
+        size_t Size() const { return m_size; }
+
+    private:
+        enum {
+            ROOT_BITS = 8,
+            LEVEL_BITS = 6,
+            LEVELS = 4,
+            ROOT_SIZE = 1 << ROOT_BITS,
+            ROOT_MASK = ROOT_SIZE - 1,
+            LEVEL_SIZE = 1 << LEVEL_BITS,
+            LEVEL_MASK = LEVEL_SIZE - 1,
+            MAX_TICKS = 1 << (ROOT_BITS + (LEVELS - 1) * LEVEL_BITS),
+
+            // lists, heads are the first nodes
+            // [0, ROOT_SIZE) are root slots, followed by slots of upper levels
+            DUE_LIST = ROOT_SIZE + (LEVELS - 1) * LEVEL_SIZE,   // expired before added
+            RUNNING_LIST,
+            CASCADE_LIST,
+            LIST_NUM,
+        };
+
+        static const uint32_t NIL = 0xffffffff;
+        static const uint16_t NO_LIST = 0xffff;
+
+        struct Node {
+            TimerTask task;
+            int64_t expiration_us;
+            int64_t interval_us;
+            uint32_t gen;
+            uint32_t prev;
+            uint32_t next;
+            uint16_t list;  // NO_LIST when not pending
+        };
+
+        static int LevelShift(int level) { return ROOT_BITS + (level - 1) * LEVEL_BITS; }
+        static int LevelList(int level, int64_t index) {
+            return ROOT_SIZE + (level - 1) * LEVEL_SIZE + (index & LEVEL_MASK);
+        }
+
+        uint32_t AllocNode();
+        void FreeNode(uint32_t idx);
+
+        bool ListEmpty(int list) const { return m_nodes[list].next == (uint32_t)list; }
+        void Link(int list, uint32_t idx);
+        void Unlink(uint32_t idx);
+        // move all nodes of list from to the empty list to
+        void Splice(int from, int to);
+
+        // put a node to the slot of its expiration
+        void Place(uint32_t idx);
+        // redistribute timers in the current slot of level
+        // returns index of the slot
+        int Cascade(int level);
+        // run all timers in list
+        int RunList(int list);
+
+    private:
+        int64_t m_tick_us;
+        // next tick to process
+        int64_t m_current;
+
+        std::vector<Node> m_nodes;
+        uint32_t m_free;
+
+        // pending timers
+        size_t m_size;
+        // pending timers in level 0
+        size_t m_root_size;
+};
+
+}
+#endif
@@ -0,0 +1,82 @@
+#include <assert.h>
+
+#include "tree_timer_queue.h"
+
+namespace cube {
+
+TimerId TreeTimerQueue::m_next_timer_id(1);
+
+TimerId TreeTimerQueue::NextTimerId() {
+    TimerId seq = __sync_fetch_and_add(&m_next_timer_id, 1);
+    return seq;
+}
+
+TimerId TreeTimerQueue::AddTimer(TimerTask task, int64_t expiration_us, int64_t interval_us) {
+    TimerId timer_id = NextTimerId();
+    Timer timer = { timer_id, std::move(task), expiration_us, interval_us};
+    AddTimer(std::move(timer));
+    return timer_id;
+}
+
+void TreeTimerQueue::AddTimer(Timer &&timer) {
+    m_timer_expiration[timer.timer_id] = timer.expiration_us;
+    auto ret = m_timers.insert(std::move(timer));
+    assert(ret.second);
+    (void)ret;
+}
+
+TreeTimerQueue::TreeTimerQueue()
+    : m_running_timer_id(0),
+    m_running_removed(false) {
+}
+
+void TreeTimerQueue::RemoveTimer(TimerId timer_id) {
+    if (timer_id == m_running_timer_id)
+        m_running_removed = true;
+    auto it = m_timer_expiration.find(timer_id);
+    if (it == m_timer_expiration.end())
+        return;
+    struct Timer timer;
+    timer.timer_id = timer_id;
+    timer.expiration_us = it->second;
+    m_timers.erase(timer);
+    m_timer_expiration.erase(it);
+}
+
+int TreeTimerQueue::Expire(int64_t now_us, int64_t &next_expiration) {
+
+    int result = 0;
+    while (!m_timers.empty()) {
+        auto it = m_timers.begin();
+        if (it->expiration_us > now_us) break;
+
+        // task is not part of the ordering, so it is safe to
+        // move it out of the node which is erased right after
+        Timer timer = std::move(const_cast<Timer &>(*it));
+        m_timer_expiration.erase(timer.timer_id);
+        m_timers.erase(it);
+
+        m_running_timer_id = timer.timer_id;
+        m_running_removed = false;
+        timer.task();
+        m_running_timer_id = 0;
+        result++;
+
+        // re-add timer, unless removed by its task
+        if (timer.interval_us > 0 && !m_running_removed) {
+            timer.expiration_us += timer.interval_us;
+            AddTimer(std::move(timer));
+        }
+    }
+
+    next_expiration = NextExpiration(now_us);
+    return result;
+}
+
+int64_t TreeTimerQueue::NextExpiration(int64_t now_us) const {
+    if (m_timers.empty())
+        return -1;
+    return m_timers.begin()->expiration_us;
+}
+
+}
@@ -0,0 +1,56 @@
+#ifndef __CUBE_TREE_TIMER_QUEUE_H__
+#define __CUBE_TREE_TIMER_QUEUE_H__
+
+#include <set>
+#include <map>
+
+#include "timer_queue.h"
+
+namespace cube {
+
+struct Timer {
+    TimerId timer_id;
+    TimerTask task;
+    int64_t expiration_us;   
+    int64_t interval_us;
+    bool operator<(const Timer &rhs) const {
+        if (expiration_us != rhs.expiration_us)
+            return expiration_us < rhs.expiration_us;
+        return timer_id < rhs.timer_id;
+    }
+};
+
+// timers ordered by expiration in a std::set
+class TreeTimerQueue : public TimerQueue {
+    public:
+        TreeTimerQueue();
+
+        Type GetType() const { return Type_Tree; }
+
+        TimerId AddTimer(TimerTask task, int64_t expiration_us, int64_t interval_us);
+        void RemoveTimer(TimerId timer_id);
+
+        int Expire(int64_t now_us, int64_t &next_expiration);
+
+        int64_t NextExpiration(int64_t now_us) const;
+
+        size_t Size() const { return m_timers.size(); }
+
+    private:
+        static TimerId NextTimerId();
+
+        static TimerId m_next_timer_id;  // atomic
+
+        void AddTimer(Timer &&timer);
+
+    private:
+        std::set<Timer> m_timers;
+        std::map<TimerId, int64_t> m_timer_expiration;
+
+        // timer being run, which is not in the queue
+        TimerId m_running_timer_id;
+        bool m_running_removed;
+};
+
+}
+#endif
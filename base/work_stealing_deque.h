@@ -0,0 +1,109 @@
+#ifndef __CUBE_WORK_STEALING_DEQUE_H__
+#define __CUBE_WORK_STEALING_DEQUE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <vector>
+
+namespace cube {
+
+// Chase-Lev deque of pointers with fixed capacity.
+// the owner pushes and pops at the bottom, thieves steal from the top.
+// memory orders follow "Correct and Efficient Work-Stealing for
+// Weak Memory Models" (Le et al., PPoPP 2013).
+template<typename T>
+class WorkStealingDeque {
+    public:
+        // capacity must be a power of 2
+        explicit WorkStealingDeque(size_t capacity)
+            : m_mask(capacity - 1),
+            m_items(capacity),
+            m_top(0),
+            m_bottom(0) {
+        }
+
+        // owner only, return false when full
+        bool Push(T *item);
+        // owner only, return NULL when empty
+        T *Pop();
+        // any thread, return NULL when empty or lost the race
+        T *Steal();
+
+        bool Empty() const {
+            int64_t t = m_top.load(std::memory_order_relaxed);
+            int64_t b = m_bottom.load(std::memory_order_relaxed);
+            return b <= t;
+        }
+
+    private:
+        // noncopyable
+        WorkStealingDeque(const WorkStealingDeque &) = delete;
+        WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+    private:
+        const size_t m_mask;
+        std::vector<std::atomic<T *>> m_items;
+        // keep thieves and owner on different cache lines,
+        // padded instead of alignas since new is not aligned in c++0x
+        char m_pad0[64];
+        std::atomic<int64_t> m_top;
+        char m_pad1[64];
+        std::atomic<int64_t> m_bottom;
+        char m_pad2[64];
+};
+
+template<typename T>
+bool WorkStealingDeque<T>::Push(T *item) {
+    int64_t b = m_bottom.load(std::memory_order_relaxed);
+    int64_t t = m_top.load(std::memory_order_acquire);
+    if (b - t > static_cast<int64_t>(m_mask))
+        return false;
+    m_items[b & m_mask].store(item, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    m_bottom.store(b + 1, std::memory_order_relaxed);
+    return true;
+}
+
+template<typename T>
+T *WorkStealingDeque<T>::Pop() {
+    int64_t b = m_bottom.load(std::memory_order_relaxed) - 1;
+    m_bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = m_top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+        // empty
+        m_bottom.store(b + 1, std::memory_order_relaxed);
+        return NULL;
+    }
+
+    T *item = m_items[b & m_mask].load(std::memory_order_relaxed);
+    if (t == b) {
+        // the last one, race with thieves
+        if (!m_top.compare_exchange_strong(t, t + 1,
+                    std::memory_order_seq_cst, std::memory_order_relaxed))
+            item = NULL;
+        m_bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return item;
+}
+
+template<typename T>
+T *WorkStealingDeque<T>::Steal() {
+    int64_t t = m_top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = m_bottom.load(std::memory_order_acquire);
+    if (t >= b)
+        return NULL;
+
+    T *item = m_items[t & m_mask].load(std::memory_order_relaxed);
+    if (!m_top.compare_exchange_strong(t, t + 1,
+                std::memory_order_seq_cst, std::memory_order_relaxed))
+        return NULL;
+    return item;
+}
+
+}
+
+#endif
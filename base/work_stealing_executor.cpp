@@ -0,0 +1,232 @@
+#include <assert.h>
+
+#include "work_stealing_executor.h"
+
+namespace cube {
+
+const size_t WorkStealingExecutor::DEQUE_CAPACITY;
+const size_t WorkStealingExecutor::INJECTION_BATCH;
+
+// worker of the current thread
+static __thread void *tls_executor = NULL;
+static __thread void *tls_worker = NULL;
+
+WorkStealingExecutor::WorkStealingExecutor(size_t thread_num)
+    : m_thread_num(thread_num),
+    m_stopping(false),
+    m_injection_size(0),
+    m_searching(0),
+    m_parked(0),
+    m_wakeups(0) {
+    assert(thread_num > 0);
+    for (size_t i = 0; i < thread_num; i++) {
+        m_workers.push_back(std::unique_ptr<Worker>(new Worker));
+        m_workers[i]->seed = i * 2654435761u + 1;
+    }
+}
+
+WorkStealingExecutor::~WorkStealingExecutor() {
+    if (!m_threads.empty())
+        Stop();
+
+    // drop tasks not run
+    for (size_t i = 0; i < m_workers.size(); i++) {
+        Task *task;
+        while ((task = m_workers[i]->deque.Steal()) != NULL)
+            delete task;
+    }
+    for (auto it = m_injection.begin(); it != m_injection.end(); it++)
+        delete *it;
+}
+
+void WorkStealingExecutor::Start() {
+    assert(m_threads.empty());
+    m_stopping = false;
+    for (size_t i = 0; i < m_thread_num; i++) {
+        m_threads.push_back(std::unique_ptr<std::thread>(new std::thread(
+                        std::bind(&WorkStealingExecutor::ThreadFunc, this, i))));
+    }
+}
+
+void WorkStealingExecutor::Stop() {
+    m_stopping = true;
+    {
+        std::unique_lock<std::mutex> lock(m_park_mutex);
+        m_park_cv.notify_all();
+    }
+    for (size_t i = 0; i < m_threads.size(); i++)
+        m_threads[i]->join();
+    m_threads.clear();
+}
+
+void WorkStealingExecutor::Submit(Task task) {
+    Task *item = new Task(std::move(task));
+
+    Worker *worker = NULL;
+    if (tls_executor == this)
+        worker = static_cast<Worker *>(tls_worker);
+
+    if (worker == NULL) {
+        std::unique_lock<std::mutex> lock(m_injection_mutex);
+        m_injection.push_back(item);
+        m_injection_size.store(m_injection.size(), std::memory_order_relaxed);
+    } else if (!worker->deque.Push(item)) {
+        Overflow(worker, item);
+    }
+
+    // pairs with the fence in Park()
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // a searching worker will find the task, and wake another one then
+    if (m_searching.load(std::memory_order_relaxed) == 0)
+        Unpark();
+}
+
+void WorkStealingExecutor::Overflow(Worker *worker, Task *item) {
+    // move the older half of the full deque to the injection queue,
+    // so that the next pushes do not take the lock again
+    Task *tasks[DEQUE_CAPACITY / 2];
+    size_t num = 0;
+    while (num < DEQUE_CAPACITY / 2) {
+        Task *task = worker->deque.Steal();
+        if (task == NULL)
+            break;
+        tasks[num++] = task;
+    }
+
+    std::unique_lock<std::mutex> lock(m_injection_mutex);
+    m_injection.insert(m_injection.end(), tasks, tasks + num);
+    m_injection.push_back(item);
+    m_injection_size.store(m_injection.size(), std::memory_order_relaxed);
+}
+
+void WorkStealingExecutor::ThreadFunc(size_t idx) {
+    Worker *worker = m_workers[idx].get();
+    tls_executor = this;
+    tls_worker = worker;
+
+    bool searching = false;
+    while (!m_stopping.load(std::memory_order_relaxed)) {
+        Task *task = FindTask(worker);
+        if (searching) {
+            searching = false;
+            // the last searcher found a task, there may be more
+            if (m_searching.fetch_sub(1, std::memory_order_seq_cst) == 1 && task) {
+                // pairs with the fence in Submit()
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (HasTask())
+                    Unpark();
+            }
+        }
+        if (task) {
+            RunTask(task);
+        } else {
+            Park();
+            searching = true;
+        }
+    }
+    if (searching)
+        m_searching.fetch_sub(1, std::memory_order_relaxed);
+
+    tls_executor = NULL;
+    tls_worker = NULL;
+}
+
+WorkStealingExecutor::Task *WorkStealingExecutor::FindTask(Worker *worker) {
+    Task *task = worker->deque.Pop();
+    if (task) return task;
+    task = PopInjection(worker);
+    if (task) return task;
+    return StealTask(worker);
+}
+
+WorkStealingExecutor::Task *WorkStealingExecutor::PopInjection(Worker *worker) {
+    if (m_injection_size.load(std::memory_order_relaxed) == 0)
+        return NULL;
+
+    std::unique_lock<std::mutex> lock(m_injection_mutex);
+    if (m_injection.empty())
+        return NULL;
+    Task *task = m_injection.front();
+    m_injection.pop_front();
+
+    // take a batch to the local deque, so that others can steal them
+    size_t num = m_injection.size() / m_thread_num;
+    if (num > INJECTION_BATCH) num = INJECTION_BATCH;
+    for (size_t i = 0; i < num; i++) {
+        if (!worker->deque.Push(m_injection.front()))
+            break;
+        m_injection.pop_front();
+    }
+    m_injection_size.store(m_injection.size(), std::memory_order_relaxed);
+    return task;
+}
+
+WorkStealingExecutor::Task *WorkStealingExecutor::StealTask(Worker *worker) {
+    if (m_thread_num == 1)
+        return NULL;
+
+    // start from a random victim
+    worker->seed ^= worker->seed << 13;
+    worker->seed ^= worker->seed >> 17;
+    worker->seed ^= worker->seed << 5;
+    size_t start = worker->seed % m_thread_num;
+    for (size_t i = 0; i < m_thread_num; i++) {
+        Worker *victim = m_workers[(start + i) % m_thread_num].get();
+        if (victim == worker)
+            continue;
+        Task *task = victim->deque.Steal();
+        if (task)
+            return task;
+    }
+    return NULL;
+}
+
+bool WorkStealingExecutor::HasTask() {
+    if (m_injection_size.load(std::memory_order_relaxed) > 0)
+        return true;
+    for (size_t i = 0; i < m_thread_num; i++) {
+        if (!m_workers[i]->deque.Empty())
+            return true;
+    }
+    return false;
+}
+
+void WorkStealingExecutor::Park() {
+    m_parked.fetch_add(1, std::memory_order_seq_cst);
+    // tasks submitted before the increment are visible here,
+    // those submitted after it will unpark us
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (HasTask() || m_stopping.load(std::memory_order_relaxed)) {
+        m_searching.fetch_add(1, std::memory_order_seq_cst);
+        m_parked.fetch_sub(1, std::memory_order_relaxed);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(m_park_mutex);
+    while (m_wakeups == 0 && !m_stopping.load(std::memory_order_relaxed))
+        m_park_cv.wait(lock);
+    if (m_wakeups > 0)
+        m_wakeups--;
+    // count as searching before leaving parked,
+    // so that submitters never see neither
+    m_searching.fetch_add(1, std::memory_order_seq_cst);
+    m_parked.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void WorkStealingExecutor::Unpark() {
+    if (m_parked.load(std::memory_order_relaxed) == 0)
+        return;
+    std::unique_lock<std::mutex> lock(m_park_mutex);
+    // every parked worker has a wakeup already
+    if (m_wakeups >= m_parked.load(std::memory_order_relaxed))
+        return;
+    m_wakeups++;
+    m_park_cv.notify_one();
+}
+
+void WorkStealingExecutor::RunTask(Task *task) {
+    (*task)();
+    delete task;
+}
+
+}
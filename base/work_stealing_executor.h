@@ -0,0 +1,90 @@
+#ifndef __CUBE_WORK_STEALING_EXECUTOR_H__
+#define __CUBE_WORK_STEALING_EXECUTOR_H__
+
+#include <stdint.h>
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "function.h"
+#include "work_stealing_deque.h"
+
+namespace cube {
+
+// executor for many small tasks.
+// each worker has its own deque, tasks submitted by a worker go to its
+// deque, others go to the global injection queue. idle workers steal
+// from the others, and park when there is nothing to run.
+class WorkStealingExecutor {
+    public:
+        typedef Function<void(), 88> Task;
+
+        static const size_t DEQUE_CAPACITY = 4096;
+        // tasks moved from the injection queue to a deque at once
+        static const size_t INJECTION_BATCH = 32;
+
+        explicit WorkStealingExecutor(size_t thread_num);
+        ~WorkStealingExecutor();
+
+        void Start();
+        // tasks not run yet are dropped
+        void Stop();
+
+        // thread-safety
+        void Submit(Task task);
+
+        size_t ThreadNum() const { return m_thread_num; }
+
+    private:
+        struct Worker {
+            Worker() : deque(DEQUE_CAPACITY), seed(0) {}
+            WorkStealingDeque<Task> deque;
+            uint32_t seed;
+        };
+
+        void Overflow(Worker *worker, Task *item);
+        void ThreadFunc(size_t idx);
+
+        Task *FindTask(Worker *worker);
+        Task *PopInjection(Worker *worker);
+        Task *StealTask(Worker *worker);
+        bool HasTask();
+
+        void Park();
+        void Unpark();
+
+        void RunTask(Task *task);
+
+    private:
+        // noncopyable
+        WorkStealingExecutor(const WorkStealingExecutor &) = delete;
+        WorkStealingExecutor &operator=(const WorkStealingExecutor &) = delete;
+
+    private:
+        size_t m_thread_num;
+        std::vector<std::unique_ptr<Worker>> m_workers;
+        std::vector<std::unique_ptr<std::thread>> m_threads;
+        std::atomic<bool> m_stopping;
+
+        // injection queue
+        std::mutex m_injection_mutex;
+        std::deque<Task *> m_injection;
+        std::atomic<size_t> m_injection_size;
+
+        // parking
+        std::mutex m_park_mutex;
+        std::condition_variable m_park_cv;
+        // workers looking for tasks after unparked
+        std::atomic<size_t> m_searching;
+        std::atomic<size_t> m_parked;
+        // wakeups not taken by parked workers yet
+        size_t m_wakeups;
+};
+
+}
+
+#endif
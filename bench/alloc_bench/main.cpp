@@ -0,0 +1,170 @@
+// heap allocations per request of the pong and HTTP hello paths,
+// client and server run in one loop, global operator new is counted
+// usage: alloc_bench [requests]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <functional>
+
+#include "base/logging.h"
+#include "net/connector.h"
+#include "net/event_loop.h"
+#include "net/inet_addr.h"
+#include "net/tcp_connection.h"
+#include "net/tcp_server.h"
+#include "net/http/http_connection.h"
+#include "net/http/http_server.h"
+
+using namespace cube;
+using namespace cube::net;
+using namespace cube::http;
+using namespace std::placeholders;
+
+static uint64_t g_allocs = 0;
+
+void *operator new(size_t size) {
+    g_allocs++;
+    void *p = malloc(size ? size : 1);
+    if (p == NULL)
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void *p) noexcept {
+    free(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+    free(p);
+}
+
+static const int WARMUP = 1000;
+
+static int g_requests = 0;
+static int g_responses = 0;
+static uint64_t g_begin_allocs = 0;
+static uint64_t g_end_allocs = 0;
+static EventLoop *g_event_loop = NULL;
+
+// returns false when finished
+static bool Count() {
+    g_responses++;
+    if (g_responses == WARMUP)
+        g_begin_allocs = g_allocs;
+    if (g_responses == WARMUP + g_requests) {
+        g_end_allocs = g_allocs;
+        g_event_loop->Stop();
+        return false;
+    }
+    return true;
+}
+
+static void Report(const char *name) {
+    printf("%-6s requests=%d allocs=%lu allocs/request=%.2f\n", name, g_requests,
+            g_end_allocs - g_begin_allocs,
+            (double)(g_end_allocs - g_begin_allocs) / g_requests);
+}
+
+// pong
+
+static void OnPing(TcpConnectionPtr conn, Buffer *buffer) {
+    buffer->Retrieve(4);
+    conn->Write("pong");
+    conn->ReadBytes(4, std::bind(&OnPing, _1, _2));
+}
+
+static void OnPingConnection(TcpConnectionPtr conn) {
+    if (conn->GetState() == TcpConnection::ConnState_Connected)
+        conn->ReadBytes(4, std::bind(&OnPing, _1, _2));
+}
+
+static void OnPong(TcpConnectionPtr conn, Buffer *buffer) {
+    buffer->Retrieve(4);
+    if (!Count())
+        return;
+    conn->Write("ping");
+    conn->ReadBytes(4, std::bind(&OnPong, _1, _2));
+}
+
+static void OnPongConnection(TcpConnectionPtr conn) {
+    if (conn->GetState() == TcpConnection::ConnState_Connected) {
+        conn->Write("ping");
+        conn->ReadBytes(4, std::bind(&OnPong, _1, _2));
+    }
+}
+
+// http hello
+
+static const char *HTTP_REQUEST = "GET / HTTP/1.1\r\nHost: localhost\r\n\r\n";
+static const char *HTTP_BODY = "Hello, World!";
+
+static void OnHTTPRequest(HTTPConnectionPtr conn, const HTTPRequest &request) {
+    HTTPResponse response;
+    response.SetProto(request.Proto());
+    response.SetStatusCode(HTTPStatus_OK);
+    response.Write(HTTP_BODY);
+    conn->SendResponse(response);
+}
+
+static void OnHTTPResponse(TcpConnectionPtr conn, Buffer *buffer) {
+    const char *end = buffer->Find(HTTP_BODY);
+    buffer->Retrieve(end - buffer->Peek() + strlen(HTTP_BODY));
+    if (!Count())
+        return;
+    conn->Write(HTTP_REQUEST);
+    conn->ReadUntil(HTTP_BODY, std::bind(&OnHTTPResponse, _1, _2));
+}
+
+static void OnHTTPConnection(TcpConnectionPtr conn) {
+    if (conn->GetState() == TcpConnection::ConnState_Connected) {
+        conn->Write(HTTP_REQUEST);
+        conn->ReadUntil(HTTP_BODY, std::bind(&OnHTTPResponse, _1, _2));
+    }
+}
+
+static void OnClose(TcpConnectionPtr conn) {
+}
+
+static void Run(const InetAddr &addr, const ConnectionCallback &connection_callback) {
+    g_responses = 0;
+    TcpConnectionPtr conn = Connector::Connect(g_event_loop, addr);
+    if (!conn) {
+        printf("connect failed\n");
+        exit(1);
+    }
+    conn->SetConnectionCallback(connection_callback);
+    conn->SetCloseCallback(std::bind(&OnClose, _1));
+    conn->EnableWriting();
+    g_event_loop->Loop();
+    conn->Close();
+}
+
+int main(int argc, char **argv) {
+    g_requests = argc > 1 ? atoi(argv[1]) : 100000;
+    logging::SetLoggerLevel(logging::LogLevel_Error);
+
+    EventLoop event_loop;
+    g_event_loop = &event_loop;
+
+    InetAddr pong_addr("127.0.0.1", 18456);
+    TcpServer pong_server(&event_loop, pong_addr);
+    pong_server.SetConnectionCallback(std::bind(&OnPingConnection, _1));
+    if (!pong_server.Start()) {
+        printf("start pong server failed\n");
+        return 1;
+    }
+    Run(pong_addr, std::bind(&OnPongConnection, _1));
+    Report("pong");
+
+    InetAddr http_addr("127.0.0.1", 18457);
+    HTTPServer http_server(&event_loop, http_addr);
+    http_server.SetRequestCallback(std::bind(&OnHTTPRequest, _1, _2));
+    if (!http_server.Start()) {
+        printf("start http server failed\n");
+        return 1;
+    }
+    Run(http_addr, std::bind(&OnHTTPConnection, _1));
+    Report("http");
+    return 0;
+}
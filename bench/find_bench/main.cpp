@@ -0,0 +1,91 @@
+// search of "\r\n\r\n" in http headers of 256B..8KB
+// search: one search of complete headers, std::search vs Buffer::Find
+// arrival: headers arrive in chunks, search after each chunk like ReadUntil,
+// rescan from the start vs only the bytes since last search
+#include <stdio.h>
+#include <string>
+#include <algorithm>
+
+#include "base/buffer.h"
+#include "base/time_util.h"
+
+using namespace cube;
+
+static const char *DELIMITER = "\r\n\r\n";
+static const size_t DELIMITER_LEN = 4;
+static const size_t CHUNK = 256;
+static const size_t BYTES = 256 * 1024 * 1024;
+
+static size_t g_found = 0;
+
+static std::string MakeHeaders(size_t size) {
+    std::string headers = "GET /index.html?uid=10086 HTTP/1.1\r\nHost: www.example.com\r\n";
+    char line[128];
+    for (int i = 0; headers.size() + DELIMITER_LEN < size; i++) {
+        snprintf(line, sizeof(line), "X-Header-%d: value-of-the-header-%d-abcdefghijklmn\r\n", i, i);
+        headers += line;
+    }
+    headers.resize(size - DELIMITER_LEN);
+    headers += DELIMITER;
+    return headers;
+}
+
+// ns per search
+static double BenchSearch(const std::string &headers, bool use_buffer) {
+    Buffer buffer;
+    buffer.Append(headers);
+    const char *begin = headers.data();
+    const char *end = begin + headers.size();
+    size_t rounds = BYTES / headers.size();
+    int64_t start = TimeUtil::CurrentTimeMicros();
+    for (size_t i = 0; i < rounds; i++) {
+        if (use_buffer) {
+            if (buffer.Find(DELIMITER, DELIMITER + DELIMITER_LEN) != NULL)
+                g_found++;
+        } else {
+            if (std::search(begin, end, DELIMITER, DELIMITER + DELIMITER_LEN) != end)
+                g_found++;
+        }
+        asm volatile("" ::: "memory");
+    }
+    return (TimeUtil::CurrentTimeMicros() - start) * 1000.0 / rounds;
+}
+
+// ns per request
+static double BenchArrival(const std::string &headers, bool incremental) {
+    Buffer buffer;
+    size_t rounds = BYTES / headers.size() / 4;
+    int64_t start = TimeUtil::CurrentTimeMicros();
+    for (size_t i = 0; i < rounds; i++) {
+        size_t scanned = 0;
+        for (size_t off = 0; off < headers.size(); off += CHUNK) {
+            buffer.Append(headers.data() + off, std::min(CHUNK, headers.size() - off));
+            size_t from = 0;
+            if (incremental && scanned > DELIMITER_LEN - 1)
+                from = scanned - (DELIMITER_LEN - 1);
+            scanned = buffer.ReadableBytes();
+            if (buffer.FindFrom(buffer.Peek() + from, DELIMITER, DELIMITER + DELIMITER_LEN) != NULL) {
+                g_found++;
+                break;
+            }
+        }
+        buffer.RetrieveAll();
+    }
+    return (TimeUtil::CurrentTimeMicros() - start) * 1000.0 / rounds;
+}
+
+int main() {
+    const size_t sizes[] = { 256, 512, 1024, 2048, 4096, 8192 };
+    printf("%-8s %14s %14s %14s %14s\n", "headers",
+            "search(ns)", "find(ns)", "rescan(ns)", "incr(ns)");
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        std::string headers = MakeHeaders(sizes[i]);
+        double search = BenchSearch(headers, false);
+        double find = BenchSearch(headers, true);
+        double rescan = BenchArrival(headers, false);
+        double incr = BenchArrival(headers, true);
+        printf("%-8zu %14.1f %14.1f %14.1f %14.1f\n", sizes[i], search, find, rescan, incr);
+    }
+    printf("found %zu\n", g_found);
+    return 0;
+}
@@ -0,0 +1,96 @@
+// join overhead of a fan-out of N calls, N = 5..50
+// counter: callbacks count down a shared context, the last one joins
+// future: callbacks set promises, WhenAll joins the futures
+// the completions are callbacks like HTTPClient::ResponseCallback
+#include <stdio.h>
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include "base/future.h"
+#include "base/time_util.h"
+
+using namespace cube;
+using namespace std::placeholders;
+
+typedef std::function<void(int)> Callback;
+
+static const int CALLS = 2000000;
+
+static long long g_sum = 0;
+
+static void OnJoined(const std::vector<int> &values) {
+    for (size_t i = 0; i < values.size(); i++)
+        g_sum += values[i];
+}
+
+// the hand-rolled join
+class Counter {
+    public:
+        explicit Counter(size_t num) : m_pending(num), m_values(num) {}
+        void OnValue(size_t idx, int value) {
+            m_values[idx] = value;
+            if (--m_pending == 0)
+                OnJoined(m_values);
+        }
+
+    private:
+        size_t m_pending;
+        std::vector<int> m_values;
+};
+
+static void IssueCounter(size_t num, std::vector<Callback> &calls) {
+    std::shared_ptr<Counter> counter = std::make_shared<Counter>(num);
+    for (size_t i = 0; i < num; i++)
+        calls.push_back(std::bind(&Counter::OnValue, counter, i, _1));
+}
+
+static void SetValue(Promise<int> &promise, int value) {
+    promise.SetValue(value);
+}
+
+static void OnJoinedFuture(std::vector<int> &&values) {
+    OnJoined(values);
+}
+
+static void IssueFuture(size_t num, std::vector<Callback> &calls) {
+    std::vector<Future<int> > futures;
+    futures.reserve(num);
+    for (size_t i = 0; i < num; i++) {
+        Promise<int> promise;
+        futures.push_back(promise.GetFuture());
+        calls.push_back(std::bind(&SetValue, promise, _1));
+    }
+    WhenAll(futures).Then(&OnJoinedFuture);
+}
+
+// ns per call, issue all fan-outs of a batch then complete them
+static double Bench(void (*issue)(size_t, std::vector<Callback> &), size_t fan_out) {
+    const size_t batch = 1000;
+    std::vector<Callback> calls;
+    calls.reserve(batch * fan_out);
+    int rounds = CALLS / (batch * fan_out);
+    int64_t begin = TimeUtil::CurrentTimeMicros();
+    for (int r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < batch; i++)
+            issue(fan_out, calls);
+        for (size_t i = 0; i < calls.size(); i++)
+            calls[i](1);
+        calls.clear();
+    }
+    int64_t cost_us = TimeUtil::CurrentTimeMicros() - begin;
+    return cost_us * 1000.0 / (rounds * batch * fan_out);
+}
+
+int main() {
+    const size_t fan_outs[] = { 5, 10, 20, 50 };
+    printf("%-8s %14s %14s\n", "fan-out", "counter(ns)", "future(ns)");
+    for (size_t i = 0; i < sizeof(fan_outs) / sizeof(fan_outs[0]); i++) {
+        size_t n = fan_outs[i];
+        double counter = Bench(&IssueCounter, n);
+        double future = Bench(&IssueFuture, n);
+        printf("%-8zu %14.1f %14.1f\n", n, counter, future);
+    }
+    printf("sum %lld\n", g_sum);
+    return 0;
+}
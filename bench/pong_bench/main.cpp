@@ -0,0 +1,75 @@
+// ping-pong client for examples/pong
+// usage: pong_bench [conns] [seconds] [epoll|uring]
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include <functional>
+
+#include "base/time_util.h"
+#include "net/connector.h"
+#include "net/event_loop.h"
+#include "net/inet_addr.h"
+#include "net/tcp_connection.h"
+
+using namespace cube;
+using namespace cube::net;
+using namespace std::placeholders;
+
+static int64_t g_pongs = 0;
+static std::map<uint64_t, TcpConnectionPtr> g_conns;
+
+static void OnPong(TcpConnectionPtr conn, Buffer *buffer) {
+    g_pongs++;
+    buffer->Retrieve(4);
+    conn->Write("ping");
+    conn->ReadBytes(4, std::bind(&OnPong, _1, _2));
+}
+
+static void OnConnection(TcpConnectionPtr conn) {
+    if (conn->GetState() == TcpConnection::ConnState_Connected) {
+        conn->Write("ping");
+        conn->ReadBytes(4, std::bind(&OnPong, _1, _2));
+    }
+}
+
+static void OnClose(TcpConnectionPtr conn) {
+    g_conns.erase(conn->Id());
+}
+
+static void Finish(EventLoop *event_loop, int64_t begin_ms) {
+    int64_t cost_ms = TimeUtil::CurrentTimeMillis() - begin_ms;
+    printf("poller=%s conns=%lu pongs=%ld qps=%.0f\n",
+            event_loop->PollerType() == Poller::Type_IoUring ? "io_uring" : "epoll",
+            g_conns.size(), g_pongs, g_pongs * 1000.0 / cost_ms);
+    std::map<uint64_t, TcpConnectionPtr> conns = g_conns;
+    for (auto it = conns.begin(); it != conns.end(); it++)
+        it->second->Close();
+    event_loop->Stop();
+}
+
+int main(int argc, char **argv) {
+    int conns = argc > 1 ? atoi(argv[1]) : 64;
+    int seconds = argc > 2 ? atoi(argv[2]) : 10;
+    Poller::Type poller_type = Poller::Type_Epoll;
+    if (argc > 3 && strcmp(argv[3], "uring") == 0)
+        poller_type = Poller::Type_IoUring;
+
+    EventLoop event_loop(poller_type);
+    InetAddr addr("127.0.0.1", 8456);
+    for (int i = 0; i < conns; i++) {
+        TcpConnectionPtr conn = Connector::Connect(&event_loop, addr);
+        if (!conn) {
+            printf("connect failed\n");
+            return 1;
+        }
+        conn->SetConnectionCallback(std::bind(&OnConnection, _1));
+        conn->SetCloseCallback(std::bind(&OnClose, _1));
+        conn->EnableWriting();
+        g_conns[conn->Id()] = conn;
+    }
+
+    event_loop.RunAfter(std::bind(&Finish, &event_loop, TimeUtil::CurrentTimeMillis()), seconds * 1000);
+    event_loop.Loop();
+    return 0;
+}
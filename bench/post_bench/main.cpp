@@ -0,0 +1,128 @@
+// cross-thread post throughput: MpscQueue vs mutex + vector,
+// and EventLoop::Post end to end, at 1/4/16 producers
+#include <stdio.h>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <functional>
+
+#include "base/mpsc_queue.h"
+#include "base/time_util.h"
+#include "net/event_loop.h"
+
+using namespace cube;
+using namespace cube::net;
+
+static const int TOTAL = 4000000;
+
+class MutexQueue {
+    public:
+        bool Push(EventLoop::Task &&task) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            bool empty = m_tasks.empty();
+            m_tasks.push_back(std::move(task));
+            return empty;
+        }
+        size_t PopAll(std::vector<EventLoop::Task> &tasks) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            tasks.swap(m_tasks);
+            return tasks.size();
+        }
+    private:
+        std::mutex m_mutex;
+        std::vector<EventLoop::Task> m_tasks;
+};
+
+static int g_executed = 0;
+
+static void Incr() {
+    g_executed++;
+}
+
+template<typename Queue>
+static void Produce(Queue *queue, int num) {
+    for (int i = 0; i < num; i++)
+        queue->Push(std::bind(&Incr));
+}
+
+template<typename Queue>
+static double BenchQueue(int producers) {
+    Queue queue;
+    g_executed = 0;
+    int64_t begin = TimeUtil::CurrentTimeMillis();
+
+    std::vector<std::thread *> threads;
+    for (int i = 0; i < producers; i++)
+        threads.push_back(new std::thread(std::bind(&Produce<Queue>, &queue, TOTAL / producers)));
+
+    std::vector<EventLoop::Task> tasks;
+    while (g_executed < TOTAL / producers * producers) {
+        queue.PopAll(tasks);
+        for (size_t i = 0; i < tasks.size(); i++)
+            tasks[i]();
+        tasks.clear();
+    }
+
+    for (size_t i = 0; i < threads.size(); i++) {
+        threads[i]->join();
+        delete threads[i];
+    }
+    int64_t cost_ms = TimeUtil::CurrentTimeMillis() - begin;
+    return TOTAL / 1000.0 / (cost_ms ? cost_ms : 1);
+}
+
+static void Post(EventLoop *event_loop, int num) {
+    for (int i = 0; i < num; i++)
+        event_loop->Post(std::bind(&Incr));
+}
+
+static void CheckDone(EventLoop *event_loop, int total) {
+    if (g_executed >= total)
+        event_loop->Stop();
+}
+
+static void RunLoop(EventLoop **event_loop, int total, std::mutex *mutex) {
+    EventLoop loop;
+    loop.RunPeriodic(std::bind(&CheckDone, &loop, total), 1);
+    mutex->lock();
+    *event_loop = &loop;
+    mutex->unlock();
+    loop.Loop();
+}
+
+static double BenchEventLoop(int producers) {
+    g_executed = 0;
+    int total = TOTAL / producers * producers;
+    EventLoop *event_loop = NULL;
+    std::mutex mutex;
+    std::thread loop_thread(std::bind(&RunLoop, &event_loop, total, &mutex));
+    while (true) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (event_loop) break;
+    }
+
+    int64_t begin = TimeUtil::CurrentTimeMillis();
+    std::vector<std::thread *> threads;
+    for (int i = 0; i < producers; i++)
+        threads.push_back(new std::thread(std::bind(&Post, event_loop, TOTAL / producers)));
+    for (size_t i = 0; i < threads.size(); i++) {
+        threads[i]->join();
+        delete threads[i];
+    }
+    loop_thread.join();
+    int64_t cost_ms = TimeUtil::CurrentTimeMillis() - begin;
+    return TOTAL / 1000.0 / (cost_ms ? cost_ms : 1);
+}
+
+int main() {
+    const int producers[] = { 1, 4, 16 };
+    printf("%-10s %16s %16s %16s\n", "producers", "mutex(M/s)", "mpsc(M/s)", "EventLoop(M/s)");
+    for (size_t i = 0; i < sizeof(producers) / sizeof(producers[0]); i++) {
+        int p = producers[i];
+        double mutex_rate = BenchQueue<MutexQueue>(p);
+        double mpsc_rate = BenchQueue<MpscQueue<EventLoop::Task> >(p);
+        double loop_rate = BenchEventLoop(p);
+        printf("%-10d %16.2f %16.2f %16.2f\n", p, mutex_rate, mpsc_rate, loop_rate);
+    }
+    return 0;
+}
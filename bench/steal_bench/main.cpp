@@ -0,0 +1,141 @@
+// task throughput: BlockQueue pool vs WorkStealingExecutor, at 1..32 threads
+// fan-out: the main thread submits all tasks
+// fan-in: parent tasks submit children from workers, the last child signals
+#include <stdio.h>
+#include <atomic>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+
+#include "base/block_queue.h"
+#include "base/work_stealing_executor.h"
+#include "base/time_util.h"
+
+using namespace cube;
+
+static const int FAN_OUT_TASKS = 1000000;
+static const int PARENTS = 100;
+static const int CHILDREN = 10000;
+
+// wait for a number of tasks
+class Latch {
+    public:
+        explicit Latch(int count) : m_count(count) {}
+        void CountDown() {
+            if (m_count.fetch_sub(1) == 1) {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_cv.notify_all();
+            }
+        }
+        void Wait() {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while (m_count.load() > 0) m_cv.wait(lock);
+        }
+    private:
+        std::atomic<int> m_count;
+        std::mutex m_mutex;
+        std::condition_variable m_cv;
+};
+
+// the classic pool, all workers share one BlockQueue
+class QueuePool {
+    public:
+        typedef std::function<void()> Task;
+
+        explicit QueuePool(size_t thread_num) {
+            for (size_t i = 0; i < thread_num; i++)
+                m_threads.push_back(new std::thread(std::bind(&QueuePool::ThreadFunc, this)));
+        }
+        ~QueuePool() {
+            // an empty task stops a worker
+            for (size_t i = 0; i < m_threads.size(); i++)
+                m_queue.Push(Task());
+            for (size_t i = 0; i < m_threads.size(); i++) {
+                m_threads[i]->join();
+                delete m_threads[i];
+            }
+        }
+        void Submit(const Task &task) { m_queue.Push(task); }
+
+    private:
+        void ThreadFunc() {
+            while (true) {
+                Task task = m_queue.Pop();
+                if (!task) break;
+                task();
+            }
+        }
+
+    private:
+        BlockQueue<Task> m_queue;
+        std::vector<std::thread *> m_threads;
+};
+
+class StealPool {
+    public:
+        typedef WorkStealingExecutor::Task Task;
+
+        explicit StealPool(size_t thread_num) : m_executor(thread_num) {
+            m_executor.Start();
+        }
+        ~StealPool() {
+            m_executor.Stop();
+        }
+        void Submit(Task task) { m_executor.Submit(std::move(task)); }
+
+    private:
+        WorkStealingExecutor m_executor;
+};
+
+static void Leaf(Latch *latch) {
+    latch->CountDown();
+}
+
+template<typename Pool>
+static void Parent(Pool *pool, Latch *latch) {
+    for (int i = 0; i < CHILDREN; i++)
+        pool->Submit(std::bind(&Leaf, latch));
+}
+
+template<typename Pool>
+static double BenchFanOut(size_t threads) {
+    // workers are joined before the latch goes away
+    Latch latch(FAN_OUT_TASKS);
+    Pool pool(threads);
+    int64_t begin = TimeUtil::CurrentTimeMillis();
+    for (int i = 0; i < FAN_OUT_TASKS; i++)
+        pool.Submit(std::bind(&Leaf, &latch));
+    latch.Wait();
+    int64_t cost_ms = TimeUtil::CurrentTimeMillis() - begin;
+    return FAN_OUT_TASKS / 1000.0 / (cost_ms ? cost_ms : 1);
+}
+
+template<typename Pool>
+static double BenchFanIn(size_t threads) {
+    Latch latch(PARENTS * CHILDREN);
+    Pool pool(threads);
+    int64_t begin = TimeUtil::CurrentTimeMillis();
+    for (int i = 0; i < PARENTS; i++)
+        pool.Submit(std::bind(&Parent<Pool>, &pool, &latch));
+    latch.Wait();
+    int64_t cost_ms = TimeUtil::CurrentTimeMillis() - begin;
+    return PARENTS * CHILDREN / 1000.0 / (cost_ms ? cost_ms : 1);
+}
+
+int main() {
+    const size_t threads[] = { 1, 2, 4, 8, 16, 32 };
+    printf("%-8s %18s %18s %18s %18s\n", "threads",
+            "fan-out queue", "fan-out steal", "fan-in queue", "fan-in steal");
+    printf("%-8s %18s %18s %18s %18s\n", "", "(M/s)", "(M/s)", "(M/s)", "(M/s)");
+    for (size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+        size_t t = threads[i];
+        double out_queue = BenchFanOut<QueuePool>(t);
+        double out_steal = BenchFanOut<StealPool>(t);
+        double in_queue = BenchFanIn<QueuePool>(t);
+        double in_steal = BenchFanIn<StealPool>(t);
+        printf("%-8zu %18.2f %18.2f %18.2f %18.2f\n", t, out_queue, out_steal, in_queue, in_steal);
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+// add/cancel/expire cost of TreeTimerQueue vs TimingWheel
+// with 1M pending timers spread over 60 seconds
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include <memory>
+#include <functional>
+
+#include "base/timer_queue.h"
+#include "base/time_util.h"
+
+using namespace cube;
+
+static const int TIMERS = 1000000;
+static const int64_t SPAN_US = 60 * 1000 * 1000;
+static const int64_t STEP_US = 1000;
+
+static int g_fired = 0;
+
+static void OnTimer() {
+    g_fired++;
+}
+
+static double NsPerOp(int64_t begin_us, int64_t end_us, int ops) {
+    return ops > 0 ? (end_us - begin_us) * 1000.0 / ops : 0;
+}
+
+static void Bench(const char *name, TimerQueue::Type type) {
+    int64_t base_us = 1000 * 1000;
+    std::unique_ptr<TimerQueue> queue(TimerQueue::Create(type, base_us));
+    std::vector<TimerId> timer_ids;
+    timer_ids.reserve(TIMERS);
+    srand(1);
+
+    int64_t begin = TimeUtil::CurrentTimeMicros();
+    for (int i = 0; i < TIMERS; i++) {
+        int64_t expiration_us = base_us + 1 + (int64_t)rand() % SPAN_US;
+        timer_ids.push_back(queue->AddTimer(std::bind(&OnTimer), expiration_us, 0));
+    }
+    int64_t added = TimeUtil::CurrentTimeMicros();
+
+    // cancel half of them, like timeouts of finished requests
+    for (int i = 0; i < TIMERS; i += 2)
+        queue->RemoveTimer(timer_ids[i]);
+    int64_t canceled = TimeUtil::CurrentTimeMicros();
+
+    // advance the clock 1ms per step, like a busy loop
+    g_fired = 0;
+    int64_t next_expiration = 0;
+    for (int64_t now_us = base_us; now_us <= base_us + SPAN_US + STEP_US; now_us += STEP_US)
+        queue->Expire(now_us, next_expiration);
+    int64_t expired = TimeUtil::CurrentTimeMicros();
+
+    printf("%-6s add %7.1f ns/op  cancel %7.1f ns/op  expire %7.1f ns/op  fired %d left %zu\n",
+            name, NsPerOp(begin, added, TIMERS),
+            NsPerOp(added, canceled, TIMERS / 2),
+            NsPerOp(canceled, expired, g_fired), g_fired, queue->Size());
+}
+
+int main() {
+    Bench("tree", TimerQueue::Type_Tree);
+    Bench("wheel", TimerQueue::Type_Wheel);
+    return 0;
+}
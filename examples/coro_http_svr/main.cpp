@@ -0,0 +1,42 @@
+#include <iostream>
+#include <assert.h>
+#include <signal.h>
+
+#include "net/event_loop.h"
+#include "net/inet_addr.h"
+#include "net/coro/http_server.h"
+
+using namespace std;
+using namespace std::placeholders;
+using namespace cube::net;
+using namespace cube::net::coro;
+using namespace cube::http;
+
+EventLoop g_event_loop;
+
+void HandleSignal(int sig) {
+    cout << "stop" << endl;
+    cout << "signal = " << sig << endl;
+    g_event_loop.Stop();
+}
+
+Task<void> HelloHandler(TcpConnectionPtr conn, const HTTPRequest &request, HTTPResponse &response) {
+    // "/sleep" answers after 100ms without blocking the loop
+    if (request.URL() == "/sleep")
+        co_await Sleep(conn->GetEventLoop(), 100);
+    response.Write("Hello, World!");
+}
+
+int main() {
+    signal(SIGINT, HandleSignal);
+
+    InetAddr server_addr(8456);
+    CoroHTTPServer http_server(&g_event_loop, server_addr);
+    http_server.SetRequestHandler(std::bind(&HelloHandler, _1, _2, _3));
+    assert(http_server.Start());
+    printf("coroutine http server start succ, listen addr=%s\n", server_addr.IpPort().c_str());
+
+    g_event_loop.Loop();
+
+    return 0;
+}
@@ -1,5 +1,6 @@
 #include <iostream>
 #include <functional>
+#include <string.h>
 
 #include "base/time_util.h"
 #include "net/tcp_server.h"
@@ -11,7 +12,6 @@ using namespace cube::net;
 using namespace std;
 using namespace std::placeholders;
 
-EventLoop g_event_loop;
 int g_pings = 0;
 
 void OnPing(TcpConnectionPtr, Buffer *);
@@ -40,13 +40,20 @@ void ShowStat() {
     g_pings = 0;
 }
 
-int main() {
-    g_event_loop.RunPeriodic(ShowStat, 1000);
+// usage: pong [epoll|uring]
+int main(int argc, char **argv) {
+    Poller::Type poller_type = Poller::Type_Epoll;
+    if (argc > 1 && strcmp(argv[1], "uring") == 0)
+        poller_type = Poller::Type_IoUring;
+
+    EventLoop event_loop(poller_type);
+    event_loop.RunPeriodic(ShowStat, 1000);
     InetAddr addr(8456);
-    TcpServer server(&g_event_loop, addr);
+    TcpServer server(&event_loop, addr);
     server.SetConnectionCallback(std::bind(OnConnection, _1));
     server.Start();
-    printf("server start succ, listen addr=%s", addr.IpPort().c_str());
-    g_event_loop.Loop();
+    printf("server start succ, listen addr=%s, poller=%s\n", addr.IpPort().c_str(),
+            event_loop.PollerType() == Poller::Type_IoUring ? "io_uring" : "epoll");
+    event_loop.Loop();
     return 0;
 }
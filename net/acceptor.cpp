@@ -4,6 +4,7 @@
 #include <errno.h>
 #include <string.h>
 
+#include "base/logging.h"
 #include "event_loop.h"
 #include "eventor.h"
 #include "socket.h"
@@ -16,11 +17,14 @@ namespace net {
 
 Acceptor::Acceptor(EventLoop *event_loop,
 	const InetAddr &listen_addr,
-    const AcceptCallback &accept_callback)
+    AcceptCallback accept_callback)
     : m_event_loop(event_loop),
     m_sock(), m_eventor(),
     m_listen_addr(listen_addr),
-    m_accept_callback(accept_callback) {
+    m_backlog(DEFAULT_BACKLOG),
+    m_reuse_port(false),
+    m_incoming_cpu(-1),
+    m_accept_callback(std::move(accept_callback)) {
 }
 
 Acceptor::~Acceptor() {
@@ -34,8 +38,18 @@ bool Acceptor::Listen() {
     }
     m_sock.reset(new Socket(sockfd));
     m_sock->SetReuseAddr(true);
-    if (!m_sock->BindAndListen(m_listen_addr, 1024)) {
+    if (m_reuse_port && !m_sock->SetReusePort(true)) {
+        m_err_msg = std::string(strerror(errno));
+        m_sock.reset();
+        return false;
+    }
+    // not fatal, old kernels ignore it in reuse port groups
+    if (m_incoming_cpu >= 0 && !m_sock->SetIncomingCpu(m_incoming_cpu)) {
+        M_LOG_WARN("set SO_INCOMING_CPU[%d] failed, %s", m_incoming_cpu, strerror(errno));
+    }
+    if (!m_sock->BindAndListen(m_listen_addr, m_backlog)) {
         // error
+        m_err_msg = std::string(strerror(errno));
         m_sock.reset();
         return false;
     }
@@ -16,11 +16,22 @@ class Socket;
 
 class Acceptor {
     public:
+        static const int DEFAULT_BACKLOG = 1024;
+
         Acceptor(EventLoop *event_loop,
                 const InetAddr &listen_addr,
-                const AcceptCallback &accept_callback);
+                AcceptCallback accept_callback);
         ~Acceptor();
 
+        // must be called before Listen()
+        void SetBacklog(int backlog) { m_backlog = backlog; }
+        // allow several acceptors to bind the same addr,
+        // kernel distributes new connections among them
+        void SetReusePort(bool on) { m_reuse_port = on; }
+        // with reuse port, prefer this acceptor for connections
+        // whose packets are received on cpu, -1 means no preference
+        void SetIncomingCpu(int cpu) { m_incoming_cpu = cpu; }
+
         bool Listen();
         void Stop();
 
@@ -36,6 +47,9 @@ class Acceptor {
         std::unique_ptr<Eventor> m_eventor;
 
         InetAddr m_listen_addr;
+        int m_backlog;
+        bool m_reuse_port;
+        int m_incoming_cpu;
 
         AcceptCallback m_accept_callback;
         std::string m_err_msg;
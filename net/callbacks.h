@@ -3,6 +3,8 @@
 
 #include <functional>
 
+#include "base/function.h"
+
 namespace cube {
 
 class Buffer;
@@ -18,16 +20,19 @@ typedef std::shared_ptr<TcpConnection> TcpConnectionPtr;
 typedef std::shared_ptr<UdpConnection> UdpConnectionPtr;
 
 // for eventor
-typedef std::function<void(int)> EventsCallback;
+typedef ::cube::Function<void(int)> EventsCallback;
 
 // for acceptor
-typedef std::function<void(int fd)> AcceptCallback;
+typedef ::cube::Function<void(int fd)> AcceptCallback;
 
 // for tcp connection
+// connection and close callbacks are shared by all connections of a server,
+// so they are copyable. read and write callbacks are passed per call,
+// they are move-only and stored without allocation.
 typedef std::function<void(TcpConnectionPtr)> ConnectionCallback;
 typedef std::function<void(TcpConnectionPtr)> CloseCallback;
-typedef std::function<void(TcpConnectionPtr, ::cube::Buffer *)> ReadCallback;
-typedef std::function<void(TcpConnectionPtr)> WriteCompleteCallback;
+typedef ::cube::Function<void(TcpConnectionPtr, ::cube::Buffer *)> ReadCallback;
+typedef ::cube::Function<void(TcpConnectionPtr)> WriteCompleteCallback;
 
 // for udp connection
 typedef std::function<void(UdpConnectionPtr, char *, size_t, const InetAddr &)> UdpReadCallback;
@@ -0,0 +1,102 @@
+#include <new>
+
+#include "frame_pool.h"
+
+namespace cube {
+
+namespace net {
+
+namespace coro {
+
+const size_t FramePool::SIZE_CLASS;
+const size_t FramePool::MAX_FRAME_SIZE;
+const size_t FramePool::MAX_FREE_FRAMES;
+
+namespace {
+
+struct FreeFrame {
+    FreeFrame *next;
+};
+
+class ThreadFramePool {
+    public:
+        enum { CLASSES = FramePool::MAX_FRAME_SIZE / FramePool::SIZE_CLASS };
+
+        ThreadFramePool() : m_cached(0) {
+            for (size_t i = 0; i < CLASSES; i++) {
+                m_free[i] = NULL;
+                m_free_num[i] = 0;
+            }
+        }
+
+        ~ThreadFramePool() {
+            for (size_t i = 0; i < CLASSES; i++) {
+                while (m_free[i]) {
+                    FreeFrame *frame = m_free[i];
+                    m_free[i] = frame->next;
+                    ::operator delete(frame);
+                }
+            }
+        }
+
+        void *Allocate(size_t idx) {
+            FreeFrame *frame = m_free[idx];
+            if (frame == NULL)
+                return ::operator new((idx + 1) * FramePool::SIZE_CLASS);
+            m_free[idx] = frame->next;
+            m_free_num[idx]--;
+            m_cached--;
+            return frame;
+        }
+
+        void Free(void *ptr, size_t idx) {
+            if (m_free_num[idx] >= FramePool::MAX_FREE_FRAMES) {
+                ::operator delete(ptr);
+                return;
+            }
+            FreeFrame *frame = static_cast<FreeFrame *>(ptr);
+            frame->next = m_free[idx];
+            m_free[idx] = frame;
+            m_free_num[idx]++;
+            m_cached++;
+        }
+
+        size_t Cached() const { return m_cached; }
+
+    private:
+        FreeFrame *m_free[CLASSES];
+        size_t m_free_num[CLASSES];
+        size_t m_cached;
+};
+
+thread_local ThreadFramePool t_frame_pool;
+
+inline size_t SizeClass(size_t size) {
+    return (size + FramePool::SIZE_CLASS - 1) / FramePool::SIZE_CLASS - 1;
+}
+
+}
+
+void *FramePool::Allocate(size_t size) {
+    if (size == 0 || size > MAX_FRAME_SIZE)
+        return ::operator new(size);
+    return t_frame_pool.Allocate(SizeClass(size));
+}
+
+void FramePool::Free(void *ptr, size_t size) {
+    if (size == 0 || size > MAX_FRAME_SIZE) {
+        ::operator delete(ptr);
+        return;
+    }
+    t_frame_pool.Free(ptr, SizeClass(size));
+}
+
+size_t FramePool::CachedFrames() {
+    return t_frame_pool.Cached();
+}
+
+}
+
+}
+
+}
@@ -0,0 +1,37 @@
+#ifndef __CUBE_CORO_FRAME_POOL_H__
+#define __CUBE_CORO_FRAME_POOL_H__
+
+#include <stddef.h>
+
+namespace cube {
+
+namespace net {
+
+namespace coro {
+
+// free lists of coroutine frames by size class, one pool per thread.
+// coroutines of a loop always run in its thread, so frames are reused
+// by the same loop without locks. frames freed in another thread
+// are cached by that thread, every frame is a block of its size class.
+class FramePool {
+    public:
+        static const size_t SIZE_CLASS = 64;
+        // larger frames are not cached
+        static const size_t MAX_FRAME_SIZE = 4096;
+        // cached frames per size class
+        static const size_t MAX_FREE_FRAMES = 1024;
+
+        static void *Allocate(size_t size);
+        static void Free(void *ptr, size_t size);
+
+        // frames cached by the pool of this thread
+        static size_t CachedFrames();
+};
+
+}
+
+}
+
+}
+
+#endif
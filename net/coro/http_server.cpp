@@ -0,0 +1,92 @@
+#include "base/logging.h"
+#include "http_server.h"
+
+using namespace std::placeholders;
+using namespace cube::net;
+using namespace cube::net::coro;
+
+namespace cube {
+
+namespace http {
+
+const size_t CoroHTTPServer::MAX_BODY_SIZE;
+
+CoroHTTPServer::CoroHTTPServer(EventLoop *event_loop, const InetAddr &server_addr)
+    : m_event_loop(event_loop),
+    m_server(m_event_loop, server_addr),
+    m_enable_keepalive(true) {
+
+    m_server.SetConnectionCallback(std::bind(&CoroHTTPServer::OnConnection, this, _1));
+}
+
+CoroHTTPServer::~CoroHTTPServer() {
+}
+
+bool CoroHTTPServer::Start() {
+    return m_server.Start();
+}
+
+void CoroHTTPServer::Stop() {
+    m_server.Stop();
+}
+
+void CoroHTTPServer::OnConnection(TcpConnectionPtr conn) {
+    // the coroutine finds out closing by its pending read or write
+    if (conn->GetState() == TcpConnection::ConnState_Connected)
+        Spawn(conn->GetEventLoop(), Serve(conn));
+}
+
+Task<void> CoroHTTPServer::Serve(TcpConnectionPtr conn) {
+    HTTPRequest request;
+    while (true) {
+        Buffer *buffer = co_await conn->ReadUntil("\r\n\r\n");
+        if (buffer == NULL)
+            co_return;
+
+        request.Reset();
+        const char *eoh = conn->FoundDelimiter();
+        if (!request.ParseHeaders(buffer->Peek(), eoh)) {
+            M_LOG_ERROR("conn[%lu] parse headers falied", conn->Id());
+            conn->Close();
+            co_return;
+        }
+        buffer->RetrieveUntil(eoh + 4);
+
+        size_t body_len = request.ContentLength();
+        if (body_len > MAX_BODY_SIZE) {
+            conn->Close();
+            co_return;
+        }
+        if (body_len > 0) {
+            buffer = co_await conn->ReadBytes(body_len);
+            if (buffer == NULL)
+                co_return;
+            request.Write(buffer->Peek(), body_len);
+            buffer->Retrieve(body_len);
+        }
+
+        HTTPResponse response;
+        response.SetProto(request.Proto());
+        response.SetStatusCode(HTTPStatus_OK);
+        co_await m_request_handler(conn, request, response);
+        if (conn->Closed())
+            co_return;
+
+        // server does not support keep-alive
+        if (!m_enable_keepalive)
+            response.SetKeepAlive(false);
+        bool keep_alive = response.KeepAlive();
+
+        const std::string data = response.ToString();
+        if (!co_await conn->AsyncWrite(data))
+            co_return;
+        if (!keep_alive) {
+            conn->Close();
+            co_return;
+        }
+    }
+}
+
+}
+
+}
@@ -0,0 +1,68 @@
+#ifndef __CUBE_CORO_HTTP_SERVER_H__
+#define __CUBE_CORO_HTTP_SERVER_H__
+
+#include <functional>
+
+#include "net/tcp_server.h"
+#include "net/http/http_request.h"
+#include "net/http/http_response.h"
+#include "task.h"
+
+namespace cube {
+
+namespace http {
+
+// fill the response, it may co_await other coroutines,
+// which must run in conn->GetEventLoop()
+typedef std::function<::cube::net::coro::Task<void>(
+        ::cube::net::TcpConnectionPtr, const HTTPRequest &, HTTPResponse &)> CoroRequestHandler;
+
+// HTTPServer written with coroutines, one coroutine serves one connection:
+// read headers, read body, handle, write response, and again if keep alive.
+class CoroHTTPServer {
+    public:
+        static const size_t MAX_BODY_SIZE = 1024 * 1024;
+
+        CoroHTTPServer(::cube::net::EventLoop *event_loop,
+                const ::cube::net::InetAddr &server_addr);
+        ~CoroHTTPServer();
+
+        void SetRequestHandler(const CoroRequestHandler &handler) { m_request_handler = handler; }
+        bool Start();
+        void Stop();
+
+        const ::cube::net::InetAddr &ServerAddr() const { return m_server.ServerAddr(); }
+
+        // see HTTPServer
+        void SetThreadNum(size_t thread_num) { m_server.SetThreadNum(thread_num); }
+        void SetLoadBalance(::cube::net::TcpServer::LoadBalance load_balance)
+        { m_server.SetLoadBalance(load_balance); }
+        void SetThreadInitCallback(const ::cube::net::EventLoopThreadPool::ThreadInitCallback &cb)
+        { m_server.SetThreadInitCallback(cb); }
+        void SetPollerType(::cube::net::Poller::Type poller_type) { m_server.SetPollerType(poller_type); }
+        void SetReusePort(bool on) { m_server.SetReusePort(on); }
+        void SetEdgeTriggered(bool on) { m_server.SetEdgeTriggered(on); }
+        void SetBacklog(int backlog) { m_server.SetBacklog(backlog); }
+
+        bool KeepAlive() const { return m_enable_keepalive; }
+        void SetKeepAlive(bool on) { m_enable_keepalive = on; }
+
+    private:
+        void OnConnection(::cube::net::TcpConnectionPtr conn);
+        ::cube::net::coro::Task<void> Serve(::cube::net::TcpConnectionPtr conn);
+
+    private:
+        ::cube::net::EventLoop *m_event_loop;
+
+        ::cube::net::TcpServer m_server;
+
+        CoroRequestHandler m_request_handler;
+
+        bool m_enable_keepalive;
+};
+
+}
+
+}
+
+#endif
@@ -0,0 +1,219 @@
+#ifndef __CUBE_CORO_TASK_H__
+#define __CUBE_CORO_TASK_H__
+
+#include <assert.h>
+#include <coroutine>
+#include <exception>
+#include <functional>
+#include <optional>
+#include <utility>
+
+#include "net/event_loop.h"
+#include "frame_pool.h"
+
+namespace cube {
+
+namespace net {
+
+namespace coro {
+
+template<typename T = void>
+class Task;
+
+namespace detail {
+
+class PromiseBase {
+    public:
+        // frames come from the pool of the loop thread
+        static void *operator new(size_t size) { return FramePool::Allocate(size); }
+        static void operator delete(void *ptr, size_t size) { FramePool::Free(ptr, size); }
+
+        // resume the awaiting coroutine when finished,
+        // or free the frame of a detached task
+        class FinalAwaiter {
+            public:
+                bool await_ready() noexcept { return false; }
+                template<typename Promise>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept {
+                    PromiseBase &promise = handle.promise();
+                    if (promise.m_continuation)
+                        return promise.m_continuation;
+                    if (promise.m_detached) {
+                        // nobody to rethrow to, same as std::thread
+                        if (promise.m_exception)
+                            std::terminate();
+                        handle.destroy();
+                    }
+                    return std::noop_coroutine();
+                }
+                void await_resume() noexcept {}
+        };
+
+        // tasks are lazy, they start when awaited or spawned
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void unhandled_exception() { m_exception = std::current_exception(); }
+
+        void SetContinuation(std::coroutine_handle<> continuation) { m_continuation = continuation; }
+        void SetDetached() { m_detached = true; }
+
+        void RethrowIfFailed() {
+            if (m_exception)
+                std::rethrow_exception(m_exception);
+        }
+
+    private:
+        std::coroutine_handle<> m_continuation;
+        std::exception_ptr m_exception;
+        bool m_detached = false;
+};
+
+template<typename T>
+class Promise : public PromiseBase {
+    public:
+        Task<T> get_return_object();
+
+        template<typename U>
+        void return_value(U &&value) { m_value.emplace(std::forward<U>(value)); }
+
+        T Result() {
+            RethrowIfFailed();
+            return std::move(*m_value);
+        }
+
+    private:
+        std::optional<T> m_value;
+};
+
+template<>
+class Promise<void> : public PromiseBase {
+    public:
+        Task<void> get_return_object();
+
+        void return_void() {}
+
+        void Result() { RethrowIfFailed(); }
+};
+
+}
+
+// coroutine returning T, it runs in the thread of its loop.
+// co_await a task to run it and get its result,
+// or Spawn() a Task<void> to run it detached.
+template<typename T>
+class Task {
+    public:
+        typedef detail::Promise<T> promise_type;
+        typedef std::coroutine_handle<promise_type> Handle;
+
+        Task() {}
+        explicit Task(Handle handle) : m_handle(handle) {}
+        Task(Task &&other) noexcept : m_handle(other.m_handle) { other.m_handle = nullptr; }
+        ~Task() {
+            if (m_handle)
+                m_handle.destroy();
+        }
+
+        Task &operator=(Task &&other) noexcept {
+            if (this != &other) {
+                if (m_handle)
+                    m_handle.destroy();
+                m_handle = other.m_handle;
+                other.m_handle = nullptr;
+            }
+            return *this;
+        }
+
+        class Awaiter {
+            public:
+                explicit Awaiter(Handle handle) : m_handle(handle) {}
+                bool await_ready() { return !m_handle || m_handle.done(); }
+                // start the task, and continue the caller when it is done
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) {
+                    m_handle.promise().SetContinuation(caller);
+                    return m_handle;
+                }
+                T await_resume() { return m_handle.promise().Result(); }
+
+            private:
+                Handle m_handle;
+        };
+
+        Awaiter operator co_await() const & { return Awaiter(m_handle); }
+        Awaiter operator co_await() const && { return Awaiter(m_handle); }
+
+        // give up the frame, it is freed when the task finishes
+        Handle Detach() {
+            assert(m_handle);
+            m_handle.promise().SetDetached();
+            Handle handle = m_handle;
+            m_handle = nullptr;
+            return handle;
+        }
+
+    private:
+        // noncopyable
+        Task(const Task &) = delete;
+        Task &operator=(const Task &) = delete;
+
+    private:
+        Handle m_handle;
+};
+
+namespace detail {
+
+template<typename T>
+Task<T> Promise<T>::get_return_object() {
+    return Task<T>(std::coroutine_handle<Promise<T> >::from_promise(*this));
+}
+
+inline Task<void> Promise<void>::get_return_object() {
+    return Task<void>(std::coroutine_handle<Promise<void> >::from_promise(*this));
+}
+
+}
+
+// run task detached in loop, at once when called in the loop thread.
+// thread-safety
+inline void Spawn(EventLoop *loop, Task<void> task) {
+    std::coroutine_handle<> handle = task.Detach();
+    loop->RunInLoop(std::bind(&std::coroutine_handle<>::resume, handle));
+}
+
+// resume in the next loop iteration, let other events run.
+// loop of Yield and Sleep must be the one the coroutine runs in
+class Yield {
+    public:
+        explicit Yield(EventLoop *loop) : m_loop(loop) {}
+        bool await_ready() { return false; }
+        void await_suspend(std::coroutine_handle<> handle) {
+            m_loop->Post(std::bind(&std::coroutine_handle<>::resume, handle));
+        }
+        void await_resume() {}
+
+    private:
+        EventLoop *m_loop;
+};
+
+// resume after delay_ms of the loop clock
+class Sleep {
+    public:
+        Sleep(EventLoop *loop, int64_t delay_ms) : m_loop(loop), m_delay_ms(delay_ms) {}
+        bool await_ready() { return m_delay_ms <= 0; }
+        void await_suspend(std::coroutine_handle<> handle) {
+            m_loop->RunAfter(std::bind(&std::coroutine_handle<>::resume, handle), m_delay_ms);
+        }
+        void await_resume() {}
+
+    private:
+        EventLoop *m_loop;
+        int64_t m_delay_ms;
+};
+
+}
+
+}
+
+}
+
+#endif
@@ -0,0 +1,118 @@
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+#include <unistd.h> // ::close
+
+#include "base/logging.h"
+#include "epoll_poller.h"
+#include "event_loop.h"
+#include "eventor.h"
+
+namespace cube {
+
+namespace net {
+
+EpollPoller::EpollPoller(EventLoop *event_loop) 
+    : Poller(event_loop),
+    m_epoll_fd(::epoll_create(EPOLL_EVENT_SIZE)) {
+        assert(m_epoll_fd >= 0);
+}
+
+EpollPoller::~EpollPoller() {
+    ::close(m_epoll_fd);
+}
+
+EpollPoller::FdState &EpollPoller::GetFdState(int fd) {
+    assert(fd >= 0);
+    if (static_cast<size_t>(fd) >= m_fd_states.size()) {
+        FdState state = { NULL, 0, false, false };
+        m_fd_states.resize(fd + 1, state);
+    }
+    return m_fd_states[fd];
+}
+
+bool EpollPoller::UpdateEvents(Eventor *eventor) {
+    m_event_loop->AssertInLoopThread();
+    // applied in next Poll()
+    FdState &state = GetFdState(eventor->Fd());
+    state.eventor = eventor;
+    if (!state.dirty) {
+        state.dirty = true;
+        m_dirty_fds.push_back(eventor->Fd());
+    }
+    return true;
+}
+
+bool EpollPoller::RemoveEvents(Eventor *eventor) {
+    m_event_loop->AssertInLoopThread();
+    
+    FdState &state = GetFdState(eventor->Fd());
+    state.eventor = NULL;
+    if (state.added) {
+        // remove immediately, fd may be closed and reused before next Poll()
+        state.added = false;
+        state.registered_events = 0;
+        return EpollOperate(EPOLL_CTL_DEL, eventor);
+    }
+    return true;
+}
+
+void EpollPoller::ApplyChanges() {
+    for (size_t i = 0; i < m_dirty_fds.size(); i++) {
+        int fd = m_dirty_fds[i];
+        FdState &state = m_fd_states[fd];
+        state.dirty = false;
+        // removed after updating
+        if (state.eventor == NULL)
+            continue;
+
+        uint32_t events = state.eventor->Events();
+        if (state.added && events == state.registered_events)
+            continue;
+
+        int operation = state.added ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+        if (EpollOperate(operation, state.eventor)) {
+            state.added = true;
+            state.registered_events = events;
+        } else {
+            M_LOG_WARN("epoll_ctl fd[%d] op[%d] failed, errno=%d", fd, operation, errno);
+        }
+    }
+    m_dirty_fds.clear();
+}
+
+bool EpollPoller::EpollOperate(int operation, Eventor *eventor) {
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = eventor->Events();
+    ev.data.ptr = eventor;
+    if (::epoll_ctl(m_epoll_fd, operation, eventor->Fd(), &ev) < 0)
+        return false;
+    return true;
+}
+
+void EpollPoller::Poll(int timeout_ms, std::vector<Eventor *> &eventors) {
+    eventors.clear();
+
+    // apply final events of dirty fds
+    ApplyChanges();
+
+    int num_events = ::epoll_wait(m_epoll_fd, m_epoll_events, EPOLL_EVENT_SIZE, timeout_ms);
+    if (num_events < 0) {
+        if (errno != EINTR) {
+            // error
+        } else {
+            num_events = 0;
+        }
+    } else if (num_events > 0) {
+        eventors.resize(num_events);
+        for (int i = 0; i < num_events; i++) {
+            eventors[i] = static_cast<Eventor *>(m_epoll_events[i].data.ptr);
+            eventors[i]->SetRevents(m_epoll_events[i].events);
+        }
+    }
+}
+
+}
+
+}
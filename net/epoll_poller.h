@@ -0,0 +1,56 @@
+#ifndef __CUBE_EPOLL_POLLER_H__
+#define __CUBE_EPOLL_POLLER_H__
+
+#include <sys/epoll.h>
+#include <stdint.h>
+#include <vector>
+
+#include "poller.h"
+
+namespace cube {
+
+namespace net {
+
+// Interest changes are recorded in UpdateEvents, and only the final
+// events of each dirty fd are applied by epoll_ctl right before epoll_wait,
+// so flipping POLLOUT on and off in one iteration costs no syscall.
+class EpollPoller : public Poller {
+    public:
+        static const int EPOLL_EVENT_SIZE = 1024;
+
+        EpollPoller(EventLoop *event_loop);
+        virtual ~EpollPoller();
+
+        virtual Type GetType() const { return Type_Epoll; }
+
+        virtual bool UpdateEvents(Eventor *eventor);
+        virtual bool RemoveEvents(Eventor *eventor);
+
+        virtual void Poll(int timeout_ms, std::vector<Eventor *> &active_eventors);
+
+    private:
+        struct FdState {
+            Eventor *eventor;
+            uint32_t registered_events;
+            bool added;     // added to epoll
+            bool dirty;
+        };
+
+        FdState &GetFdState(int fd);
+        void ApplyChanges();
+        bool EpollOperate(int operation, Eventor *eventor);
+
+    private:
+        int m_epoll_fd;
+        struct epoll_event m_epoll_events[EPOLL_EVENT_SIZE];
+
+        // indexed by fd
+        std::vector<FdState> m_fd_states;
+        std::vector<int> m_dirty_fds;
+};
+
+}
+
+}
+
+#endif
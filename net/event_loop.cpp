@@ -1,9 +1,11 @@
 #include <sys/eventfd.h>
+#include <sys/timerfd.h>
 #include <unistd.h>
+#include <string.h>
 #include <assert.h>
+#include <algorithm>
 
 #include "base/time_util.h"
-#include "base/timer_queue.h"
 #include "event_loop.h"
 #include "eventor.h"
 #include "poller.h"
@@ -23,19 +25,42 @@ static int CreateEventFd() {
     return event_fd;
 }
 
-EventLoop::EventLoop() 
+static int CreateTimerFd() {
+    int timer_fd = ::timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+    if (timer_fd < 0) {
+        abort();
+    }
+    return timer_fd;
+}
+
+const size_t EventLoop::READ_OVERFLOW_SIZE;
+const int EventLoop::MAX_DEFER_ROUNDS;
+
+EventLoop::EventLoop(Poller::Type poller_type) 
     : m_thread_id(std::this_thread::get_id()),
     m_wakeup_fd(CreateEventFd()),
     m_wakeup_eventor(new Eventor(this, m_wakeup_fd)),
-    m_poller(new Poller(this)),
-    m_timer_queue(new TimerQueue),
-    m_running(false) {
+    m_poller(Poller::Create(this, poller_type)),
+    m_coarse_clock(false),
+    m_clock_lag_us(0),
+    m_now_us(TimeUtil::MonotonicMicros()),
+    m_timer_queue(TimerQueue::Create(TimerQueue::Type_Tree, m_now_us)),
+    m_timer_fd(CreateTimerFd()),
+    m_timer_eventor(new Eventor(this, m_timer_fd)),
+    m_timer_armed_us(-1),
+    m_running(false),
+    m_busy_poll_us(0),
+    m_sock_busy_poll_us(0) {
+    memset(&m_busy_poll_stats, 0, sizeof(m_busy_poll_stats));
     m_wakeup_eventor->SetEventsCallback(std::bind(&EventLoop::HandleEvents, this, _1));
     m_wakeup_eventor->EnableReading();
+    m_timer_eventor->SetEventsCallback(std::bind(&EventLoop::HandleTimerEvents, this, _1));
+    m_timer_eventor->EnableReading();
 }
 
 EventLoop::~EventLoop() {
     ::close(m_wakeup_fd);
+    ::close(m_timer_fd);
 }
 
 __thread EventLoop *tls_ptr = NULL;
@@ -45,13 +70,8 @@ EventLoop *EventLoop::Current() {
     return tls_ptr;
 }
 
-void EventLoop::Post(const Task &task) {
-    bool is_empty = false;
-    {
-        std::unique_lock<std::mutex> lock(m_tasks_mutex);
-        is_empty = m_tasks.empty();
-        m_tasks.push_back(task);
-    }
+void EventLoop::Post(Task task) {
+    bool is_empty = m_tasks.Push(std::move(task));
 
     // Wake up to run task when this is the first task
     // and not in loop thread
@@ -60,6 +80,41 @@ void EventLoop::Post(const Task &task) {
     }
 }
 
+void EventLoop::RunInLoop(Task task) {
+    if (IsLoopThread())
+        task();
+    else
+        Post(std::move(task));
+}
+
+void EventLoop::Defer(Task task) {
+    if (IsLoopThread())
+        m_deferred_tasks.push_back(std::move(task));
+    else
+        Post(std::move(task));
+}
+
+int EventLoop::RunDeferredTasks() {
+    int result = 0;
+    for (int round = 0; round < MAX_DEFER_ROUNDS && !m_deferred_tasks.empty(); round++) {
+        m_running_deferred_tasks.swap(m_deferred_tasks);
+        for (auto it = m_running_deferred_tasks.begin();
+                it != m_running_deferred_tasks.end(); it++) {
+            (*it)();
+        }
+        result += m_running_deferred_tasks.size();
+        m_running_deferred_tasks.clear();
+    }
+    // tasks deferring themselves again, e.g. a read callback reading
+    // again without consuming the input, must not keep the loop from
+    // polling and running timers
+    for (auto it = m_deferred_tasks.begin(); it != m_deferred_tasks.end(); it++) {
+        Post(std::move(*it));
+    }
+    m_deferred_tasks.clear();
+    return result;
+}
+
 void EventLoop::UpdateEvents(Eventor *eventor) {
     m_poller->UpdateEvents(eventor);
 }
@@ -68,82 +123,155 @@ void EventLoop::RemoveEvents(Eventor *eventor) {
     m_poller->RemoveEvents(eventor);
 }
 
-TimerId EventLoop::RunAt(const Task &task, int64_t expiration_ms) {
-    return m_timer_queue->AddTimer(task, expiration_ms, 0);
+void EventLoop::UpdateNow() {
+    if (m_coarse_clock)
+        m_now_us = TimeUtil::CoarseMonotonicMicros();
+    else
+        m_now_us = TimeUtil::MonotonicMicros();
+}
+
+void EventLoop::SetCoarseClock(bool coarse) {
+    m_coarse_clock = coarse;
+    m_clock_lag_us = coarse ? TimeUtil::CoarseMonotonicResolution() : 0;
+    UpdateNow();
+}
+
+TimerId EventLoop::RunAt(Task task, int64_t expiration_ms) {
+    // convert wall clock to loop clock
+    int64_t expiration_us = TimeUtil::MonotonicMicros() +
+        expiration_ms * 1000 - TimeUtil::CurrentTimeMicros();
+    TimerId timer_id = m_timer_queue->AddTimer(std::move(task), expiration_us, 0);
+    ArmTimerFd(expiration_us);
+    return timer_id;
 }
 
-TimerId EventLoop::RunAfter(const Task &task, int64_t delay_ms) {
-    return m_timer_queue->AddTimer(task, TimeUtil::CurrentTimeMillis() + delay_ms, 0);
+TimerId EventLoop::RunAfter(Task task, int64_t delay_ms) {
+    return RunPeriodic(std::move(task), delay_ms, 0);
 }
 
-TimerId EventLoop::RunPeriodic(const Task &task, int64_t interval_ms) {
-    return m_timer_queue->AddTimer(task, TimeUtil::CurrentTimeMillis() + interval_ms, interval_ms);
+TimerId EventLoop::RunPeriodic(Task task, int64_t interval_ms) {
+    return RunPeriodic(std::move(task), interval_ms, interval_ms);
 }
 
-TimerId EventLoop::RunPeriodic(const Task &task, int64_t delay_ms, int64_t interval_ms) {
-    return m_timer_queue->AddTimer(task, TimeUtil::CurrentTimeMillis() + delay_ms, interval_ms);
+TimerId EventLoop::RunPeriodic(Task task, int64_t delay_ms, int64_t interval_ms) {
+    int64_t expiration_us = m_now_us + m_clock_lag_us + delay_ms * 1000;
+    TimerId timer_id = m_timer_queue->AddTimer(std::move(task), expiration_us, interval_ms * 1000);
+    ArmTimerFd(expiration_us);
+    return timer_id;
 }
 
 void EventLoop::CancelTimer(TimerId timer_id) {
     m_timer_queue->RemoveTimer(timer_id);
+    // rearm when the earliest timer is cancelled, e.g. a request
+    // timeout cancelled by its response, so it does not wake up the loop
+    if (m_timer_armed_us == -1)
+        return;
+    int64_t next_expiration = m_timer_queue->NextExpiration(m_now_us);
+    if (next_expiration == -1 || next_expiration > m_timer_armed_us)
+        ResetTimerFd(next_expiration);
+}
+
+void EventLoop::SetTimerQueueType(TimerQueue::Type type) {
+    AssertInLoopThread();
+    assert(m_timer_queue->Size() == 0);
+    m_timer_queue.reset(TimerQueue::Create(type, m_now_us));
+}
+
+char *EventLoop::GetReadOverflow() {
+    if (!m_read_overflow)
+        m_read_overflow.reset(new char[READ_OVERFLOW_SIZE]);
+    return m_read_overflow.get();
 }
 
 void EventLoop::Loop() {
     AssertInLoopThread();
     m_running = true;
     while (m_running) {
-        // wait for 5ms at most
-        LoopOnce(5);
+        if (m_busy_poll_us > 0) {
+            BusyPollOnce();
+        } else {
+            // timers and wakeups are both fds, so it is safe to block
+            LoopOnce(-1);
+        }
     }
 }
 
+void EventLoop::SetBusyPoll(int64_t spin_us, int sock_busy_poll_us) {
+    AssertInLoopThread();
+    m_busy_poll_us = spin_us;
+    m_sock_busy_poll_us = sock_busy_poll_us;
+}
+
+void EventLoop::BusyPollOnce() {
+    // spin until spin budget passes without any work
+    int64_t begin_us = m_now_us;
+    int64_t idle_begin_us = begin_us;
+    int64_t now_us = begin_us;
+    while (m_running) {
+        int result = LoopOnce(0);
+        m_busy_poll_stats.spin_polls++;
+        now_us = m_now_us;
+        if (result > 0)
+            idle_begin_us = now_us;
+        else if (now_us - idle_begin_us >= m_busy_poll_us)
+            break;
+    }
+    m_busy_poll_stats.spin_us += now_us - begin_us;
+
+    // fall back to a blocking wait,
+    // sleep time is recorded in LoopOnce
+    if (m_running)
+        LoopOnce(-1);
+}
+
 int EventLoop::LoopOnce(int poll_timeout_ms) {
     AssertInLoopThread();
 
     int result = 0;
 
-    int64_t now_ms = TimeUtil::CurrentTimeMillis();
-    std::vector<Task> tasks;
-    {
-        std::unique_lock<std::mutex> lock(m_tasks_mutex);
-        tasks.swap(m_tasks);
-    }
-
-    for (auto it = tasks.begin(); it != tasks.end(); it++) {
+    // take all pending tasks at once
+    m_tasks.PopAll(m_running_tasks);
+    for (auto it = m_running_tasks.begin(); it != m_running_tasks.end(); it++) {
         (*it)();
     }
-    result += tasks.size();
+    result += m_running_tasks.size();
+    m_running_tasks.clear();
+    result += RunDeferredTasks();
 
-    // timer queue
-    int64_t next_expiration = -1;
-    result += m_timer_queue->Expire(now_ms, next_expiration);
-    
-    // poller
-    if (next_expiration > now_ms 
-            && (poll_timeout_ms == -1 || (next_expiration - now_ms) < poll_timeout_ms)) {
-        poll_timeout_ms = next_expiration - now_ms;
-    }
+    // timers are run by timer eventor
 
-    {
-        // wake up immediately when there are pending tasks
-        std::unique_lock<std::mutex> lock(m_tasks_mutex);
-        if (!m_tasks.empty()) poll_timeout_ms = 0;
-    }
+    // wake up immediately when there are pending tasks
+    if (!m_tasks.Empty()) poll_timeout_ms = 0;
 
-    std::vector<Eventor *> active_eventors;
-    m_poller->Poll(poll_timeout_ms, active_eventors);
+    // reuse the vector to avoid allocations per iteration
+    std::vector<Eventor *> &active_eventors = m_active_eventors;
+    active_eventors.clear();
+    if (m_busy_poll_us > 0 && poll_timeout_ms != 0) {
+        UpdateNow();
+        int64_t begin_us = m_now_us;
+        m_poller->Poll(poll_timeout_ms, active_eventors);
+        UpdateNow();
+        m_busy_poll_stats.sleep_us += m_now_us - begin_us;
+        m_busy_poll_stats.sleeps++;
+    } else {
+        m_poller->Poll(poll_timeout_ms, active_eventors);
+        // the only clock read of an iteration
+        UpdateNow();
+    }
     for (auto it = active_eventors.begin();
             it != active_eventors.end(); it++) {
         (*it)->HandleEvents();
         result++;
     }
+    result += RunDeferredTasks();
     return result;
 }
 
 void EventLoop::Stop() {
     m_running = false;
-    if (!IsLoopThread())
-        WakeUp();
+    // wake up even in loop thread, Stop() may be called
+    // by a task or timer just before blocking in poller
+    WakeUp();
 }
 
 void EventLoop::HandleEvents(int revents) {
@@ -152,6 +280,47 @@ void EventLoop::HandleEvents(int revents) {
     (void)ret;
 }
 
+void EventLoop::HandleTimerEvents(int revents) {
+    uint64_t expirations = 0;
+    ssize_t ret = ::read(m_timer_fd, &expirations, sizeof(expirations));
+    (void)ret;
+
+    // disarmed, timers added by tasks will rearm it
+    int64_t armed_us = m_timer_armed_us;
+    m_timer_armed_us = -1;
+
+    // coarse clock may lag behind timerfd
+    int64_t now_us = std::max(m_now_us, armed_us);
+    int64_t next_expiration = -1;
+    m_timer_queue->Expire(now_us, next_expiration);
+    if (next_expiration != -1)
+        ResetTimerFd(next_expiration);
+}
+
+void EventLoop::ArmTimerFd(int64_t expiration_us) {
+    // only rearm when the new timer expires earlier
+    if (m_timer_armed_us == -1 || expiration_us < m_timer_armed_us)
+        ResetTimerFd(expiration_us);
+}
+
+void EventLoop::ResetTimerFd(int64_t expiration_us) {
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    if (expiration_us == -1) {
+        // no timers, disarm it
+        ::timerfd_settime(m_timer_fd, 0, &its, NULL);
+        m_timer_armed_us = -1;
+        return;
+    }
+    its.it_value.tv_sec = expiration_us / (1000 * 1000);
+    its.it_value.tv_nsec = (expiration_us % (1000 * 1000)) * 1000;
+    // zero it_value disarms the timer
+    if (its.it_value.tv_sec <= 0 && its.it_value.tv_nsec <= 0)
+        its.it_value.tv_nsec = 1;
+    ::timerfd_settime(m_timer_fd, TFD_TIMER_ABSTIME, &its, NULL);
+    m_timer_armed_us = expiration_us;
+}
+
 void EventLoop::WakeUp() {
     uint64_t one = 1;
     ssize_t ret = ::write(m_wakeup_fd, &one, sizeof(one));
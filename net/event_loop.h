@@ -1,15 +1,19 @@
 #ifndef __CUBE_EVENT_LOOP_H__
 #define __CUBE_EVENT_LOOP_H__
 
+#include <stdlib.h>
 #include <functional>
 #include <memory>
 #include <vector>
 #include <thread>
-#include <mutex>
 
-namespace cube {
+#include "base/mpsc_queue.h"
+#include "base/slab_pool.h"
+#include "base/timer_queue.h"
+
+#include "poller.h"
 
-class TimerQueue;
+namespace cube {
 
 namespace net {
 
@@ -19,35 +23,89 @@ namespace net {
 typedef uint64_t TimerId;
 
 class Eventor;
-class Poller;
+
+// time spent in busy poll mode, in us
+struct BusyPollStats {
+    int64_t spin_us;        // spinning with zero-timeout polls
+    int64_t sleep_us;       // blocking in poller
+    uint64_t spin_polls;    // number of zero-timeout polls
+    uint64_t sleeps;        // number of blocking polls
+};
 
 class EventLoop {
     public:
-        typedef std::function<void()> Task;
+        typedef TimerTask Task;
 
-        EventLoop();
+        explicit EventLoop(Poller::Type poller_type = Poller::Type_Epoll);
         ~EventLoop();
 
         static EventLoop *Current();
-        // thread-safety
-        void Post(const Task &task);
-
+        // thread-safety, task runs in the next loop iteration
+        void Post(Task task);
+        // run task now in loop thread, otherwise post it
+        void RunInLoop(Task task);
+        // run task later in the current iteration without locking,
+        // e.g. callbacks that must not be called recursively.
+        // tasks deferred by deferred tasks run in the same iteration too,
+        // for MAX_DEFER_ROUNDS rounds at most, the rest is posted to the
+        // next iteration. posted when not called in loop thread
+        static const int MAX_DEFER_ROUNDS = 4;
+        void Defer(Task task);
+
+        // block until events, tasks or timers come
         void Loop();
+        // wait for poll_timeout_ms at most, -1 means infinite
         int LoopOnce(int poll_timeout_ms);
 
         void Stop();
 
+        Poller::Type PollerType() const { return m_poller->GetType(); }
+
+        // busy poll mode, must be called in loop thread
+        // Loop() spins with zero-timeout polls, and only blocks in poller
+        // after spin_us passes without any events, tasks or timers.
+        // sock_busy_poll_us > 0 sets SO_BUSY_POLL on new tcp connections.
+        // spin_us == 0 disables busy poll mode
+        void SetBusyPoll(int64_t spin_us, int sock_busy_poll_us = 0);
+        int SockBusyPollUs() const { return m_sock_busy_poll_us; }
+        const BusyPollStats &GetBusyPollStats() const { return m_busy_poll_stats; }
+
         // wrap for poller
         void UpdateEvents(Eventor *e);
         void RemoveEvents(Eventor *e);
 
+        // cached monotonic loop clock in us, refreshed once per
+        // iteration after polling, timers are measured in it
+        int64_t Now() const { return m_now_us; }
+        int64_t NowMillis() const { return m_now_us / 1000; }
+        // refresh the loop clock, for tasks running for a long time
+        void UpdateNow();
+        // coarse clock is cheaper to read, but has jiffy resolution,
+        // so timers may expire up to a jiffy later
+        void SetCoarseClock(bool coarse);
+
         // wrap for timer queue
-        TimerId RunAt(const Task &task, int64_t expiration_ms);
-        TimerId RunAfter(const Task &task, int64_t delay_ms);
-        TimerId RunPeriodic(const Task &task, int64_t interval_ms);
-        TimerId RunPeriodic(const Task &task, int64_t delay_ms, int64_t interval_ms);
+        // expiration_ms of RunAt is in wall clock, others are relative to Now()
+        TimerId RunAt(Task task, int64_t expiration_ms);
+        TimerId RunAfter(Task task, int64_t delay_ms);
+        TimerId RunPeriodic(Task task, int64_t interval_ms);
+        TimerId RunPeriodic(Task task, int64_t delay_ms, int64_t interval_ms);
         void CancelTimer(TimerId time_id);
 
+        // switch timer queue implementation, must be called
+        // in loop thread before any timer is added
+        void SetTimerQueueType(TimerQueue::Type type);
+        TimerQueue::Type TimerQueueType() const { return m_timer_queue->GetType(); }
+
+        // slabs of the buffers of connections in this loop,
+        // only used in loop thread
+        SlabPool *GetSlabPool() { return &m_slab_pool; }
+        // where reads of connections in this loop overflow their buffers,
+        // the data is copied out before the read returns, so one region
+        // is shared by all of them. allocated on first use, loop thread only
+        static const size_t READ_OVERFLOW_SIZE = 64 * 1024;
+        char *GetReadOverflow();
+
         bool IsLoopThread() const { return m_thread_id == std::this_thread::get_id(); }
         void AssertInLoopThread() const {
             if (!IsLoopThread()) {
@@ -58,8 +116,18 @@ class EventLoop {
         void WakeUp();
 
     private:
+        void BusyPollOnce();
+
+        int RunDeferredTasks();
+
         void HandleEvents(int revents);
 
+        // timers are driven by timerfd armed to the next expiration
+        void HandleTimerEvents(int revents);
+        // -1 disarms the timerfd
+        void ResetTimerFd(int64_t expiration_us);
+        void ArmTimerFd(int64_t expiration_us);
+
     private:
         // thread id
         std::thread::id m_thread_id;
@@ -70,16 +138,38 @@ class EventLoop {
 
         // poller
         std::unique_ptr<Poller> m_poller;
+        std::vector<Eventor *> m_active_eventors;
+
+        // loop clock
+        bool m_coarse_clock;
+        // lag of the clock, added to timer delays
+        int64_t m_clock_lag_us;
+        int64_t m_now_us;
 
         // timer queue
         std::unique_ptr<TimerQueue> m_timer_queue;
+        int m_timer_fd;
+        std::unique_ptr<Eventor> m_timer_eventor;
+        // expiration(us) the timerfd armed to, -1 when disarmed
+        int64_t m_timer_armed_us;
         
         // task
-        std::mutex m_tasks_mutex;
-        std::vector<Task> m_tasks;
+        MpscQueue<Task> m_tasks;
+        std::vector<Task> m_running_tasks;
+        // deferred tasks, only accessed in loop thread
+        std::vector<Task> m_deferred_tasks;
+        std::vector<Task> m_running_deferred_tasks;
         
         // running flag
         bool m_running;
+
+        SlabPool m_slab_pool;
+        std::unique_ptr<char[]> m_read_overflow;
+
+        // busy poll
+        int64_t m_busy_poll_us;
+        int m_sock_busy_poll_us;
+        BusyPollStats m_busy_poll_stats;
 };
 
 }
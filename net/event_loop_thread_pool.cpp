@@ -0,0 +1,133 @@
+#include <assert.h>
+#include <errno.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+
+#include "base/count_downer.h"
+#include "base/logging.h"
+#include "event_loop.h"
+#include "event_loop_thread_pool.h"
+
+namespace cube {
+
+namespace net {
+
+EventLoopThreadPool::EventLoopThreadPool(EventLoop *base_loop, size_t thread_num)
+    : m_base_loop(base_loop),
+    m_thread_num(thread_num),
+    m_started(false),
+    m_next(0),
+    m_poller_type(Poller::Type_Epoll),
+    m_numa_local(false) {
+}
+
+EventLoopThreadPool::~EventLoopThreadPool() {
+    if (m_started)
+        Stop();
+}
+
+void EventLoopThreadPool::Start() {
+    m_base_loop->AssertInLoopThread();
+    assert(!m_started);
+    m_started = true;
+
+    m_event_loops.assign(m_thread_num, NULL);
+    CountDowner count_downer(m_thread_num);
+    for (size_t i = 0; i < m_thread_num; i++) {
+        m_threads.push_back(std::unique_ptr<std::thread>(new std::thread(
+                        std::bind(&EventLoopThreadPool::ThreadFunc, this, i, &count_downer))));
+    }
+    // wait for all loops running
+    count_downer.Wait();
+    M_LOG_INFO("event loop thread pool started, thread_num[%lu]", m_thread_num);
+}
+
+void EventLoopThreadPool::Stop() {
+    if (!m_started) return;
+    m_started = false;
+
+    // stop in loop thread, so that tasks posted before Stop() are still executed
+    for (size_t i = 0; i < m_event_loops.size(); i++) {
+        EventLoop *event_loop = m_event_loops[i];
+        event_loop->Post(std::bind(&EventLoop::Stop, event_loop));
+    }
+    for (size_t i = 0; i < m_threads.size(); i++) {
+        m_threads[i]->join();
+    }
+    m_threads.clear();
+    m_event_loops.clear();
+}
+
+EventLoop *EventLoopThreadPool::GetNextLoop() {
+    m_base_loop->AssertInLoopThread();
+    if (m_event_loops.empty())
+        return m_base_loop;
+
+    EventLoop *event_loop = m_event_loops[m_next];
+    if (++m_next >= m_event_loops.size())
+        m_next = 0;
+    return event_loop;
+}
+
+std::vector<EventLoop *> EventLoopThreadPool::GetLoops() const {
+    if (m_event_loops.empty())
+        return std::vector<EventLoop *>(1, m_base_loop);
+    return m_event_loops;
+}
+
+int EventLoopThreadPool::GetLoopCpu(size_t idx) const {
+    if (m_cpus.empty())
+        return -1;
+    return m_cpus[idx % m_cpus.size()];
+}
+
+EventLoop *EventLoopThreadPool::GetLoopByCpu(int cpu) const {
+    if (m_cpus.empty() || cpu < 0)
+        return NULL;
+    for (size_t i = 0; i < m_event_loops.size(); i++) {
+        if (GetLoopCpu(i) == cpu)
+            return m_event_loops[i];
+    }
+    return NULL;
+}
+
+void EventLoopThreadPool::BindCpu(size_t idx) {
+    int cpu = GetLoopCpu(idx);
+    if (cpu >= 0) {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(cpu, &cpu_set);
+        int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+        if (ret != 0) {
+            M_LOG_WARN("bind io thread[%lu] to cpu[%d] failed, %s", idx, cpu, strerror(ret));
+        }
+    }
+
+    // pages are allocated on the node of the cpu touching them first,
+    // as the loop is created in this thread, so are its buffers and pools
+    if (m_numa_local && ::syscall(SYS_set_mempolicy, MPOL_LOCAL, NULL, 0) != 0) {
+        M_LOG_WARN("set numa local policy of io thread[%lu] failed, %s", idx, strerror(errno));
+    }
+}
+
+void EventLoopThreadPool::ThreadFunc(size_t idx, CountDowner *count_downer) {
+    // bind before creating the loop, so that its memory is local
+    BindCpu(idx);
+
+    // event loop must be created in its own thread
+    EventLoop event_loop(m_poller_type);
+    if (m_thread_init_callback)
+        m_thread_init_callback(&event_loop);
+    m_event_loops[idx] = &event_loop;
+    count_downer->CountDown();
+
+    event_loop.Loop();
+}
+
+}
+
+}
@@ -0,0 +1,89 @@
+#ifndef __CUBE_EVENT_LOOP_THREAD_POOL_H__
+#define __CUBE_EVENT_LOOP_THREAD_POOL_H__
+
+#include <vector>
+#include <thread>
+#include <memory>
+#include <functional>
+
+#include "poller.h"
+
+namespace cube {
+
+class CountDowner;
+
+namespace net {
+
+class EventLoop;
+
+// N event loops, each one runs in its own thread.
+// Start/Stop/GetNextLoop must be called in base loop thread.
+class EventLoopThreadPool {
+    public:
+        // run in each io thread before looping, e.g. EventLoop::SetBusyPoll
+        typedef std::function<void(EventLoop *)> ThreadInitCallback;
+
+        EventLoopThreadPool(EventLoop *base_loop, size_t thread_num);
+        ~EventLoopThreadPool();
+
+        // must be called before Start()
+        void SetThreadInitCallback(const ThreadInitCallback &cb) { m_thread_init_callback = cb; }
+        // poller backend of io loops, must be called before Start()
+        void SetPollerType(Poller::Type poller_type) { m_poller_type = poller_type; }
+        // pin loop i to cpus[i % cpus.size()], must be called before Start()
+        void SetCpuAffinity(const std::vector<int> &cpus) { m_cpus = cpus; }
+        // allocate memory of io threads from the numa node they run on,
+        // useful with SetCpuAffinity, must be called before Start()
+        void SetNumaLocal(bool on) { m_numa_local = on; }
+
+        // spawn threads, return after all loops are running
+        void Start();
+        // stop all loops and join threads
+        void Stop();
+
+        bool Started() const { return m_started; }
+
+        // round robin, return base loop when thread_num == 0
+        EventLoop *GetNextLoop();
+        EventLoop *GetLoop(size_t idx) { return m_event_loops[idx]; }
+
+        // all io loops, or base loop only when thread_num == 0
+        std::vector<EventLoop *> GetLoops() const;
+
+        // cpu loop idx is pinned to, -1 if not pinned
+        int GetLoopCpu(size_t idx) const;
+        // loop pinned to cpu, NULL if none
+        EventLoop *GetLoopByCpu(int cpu) const;
+
+        size_t ThreadNum() const { return m_thread_num; }
+
+    private:
+        void ThreadFunc(size_t idx, CountDowner *count_downer);
+        void BindCpu(size_t idx);
+
+    private:
+        // noncopyable
+        EventLoopThreadPool(const EventLoopThreadPool &) = delete;
+        EventLoopThreadPool &operator=(const EventLoopThreadPool &) = delete;
+
+    private:
+        EventLoop *m_base_loop;
+
+        const size_t m_thread_num;
+        bool m_started;
+        size_t m_next;
+
+        std::vector<std::unique_ptr<std::thread> > m_threads;
+        std::vector<EventLoop *> m_event_loops;
+
+        ThreadInitCallback m_thread_init_callback;
+        Poller::Type m_poller_type;
+        std::vector<int> m_cpus;
+        bool m_numa_local;
+};
+
+}
+
+}
+
+#endif
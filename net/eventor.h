@@ -18,7 +18,7 @@ class Eventor {
         Eventor(EventLoop *event_loop, int fd);
         ~Eventor();
 
-        void SetEventsCallback(const EventsCallback &cb) { m_events_callback = cb; }
+        void SetEventsCallback(EventsCallback cb) { m_events_callback = std::move(cb); }
 
         void HandleEvents();
 
@@ -27,9 +27,12 @@ class Eventor {
         void DisableReading() { m_events &= ~Poller::POLLIN; Update(); }
         void DisableWriting() { m_events &= ~Poller::POLLOUT; Update(); } 
         void DisableAll() { m_events = Poller::POLLNONE; Update(); }
+        void EnableEdgeTriggered() { m_events |= Poller::POLLET; Update(); }
+        void DisableEdgeTriggered() { m_events &= ~Poller::POLLET; Update(); }
 
         bool Reading() { return m_events & Poller::POLLIN; }
         bool Writing() { return m_events & Poller::POLLOUT; }
+        bool EdgeTriggered() { return m_events & Poller::POLLET; }
 
         int Fd() const { return m_fd; }
         uint32_t Events() const { return m_events; }
@@ -77,8 +77,8 @@ void HTTPClientConnection::OnHeaders(::cube::net::TcpConnectionPtr conn, Buffer
 bool HTTPClientConnection::ParseHeaders(Buffer *buffer) {
     m_response.Reset();
 
-    const char *eoh = buffer->Find("\r\n\r\n");
-    if (eoh == NULL) return false;
+    // found by ReadUntil
+    const char *eoh = m_conn->FoundDelimiter();
 
     const std::string header_str(buffer->Peek(), eoh - buffer->Peek());
     std::vector<std::string> lines;
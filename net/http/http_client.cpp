@@ -131,6 +131,48 @@ int HTTPClient::Post(const ::cube::net::InetAddr &addr,
     return Send(addr, request, callback, timeout_ms);
 }
 
+// the response is reused by the connection after callback, so keep a copy
+static void SetResponse(::cube::Promise<HTTPClient::HTTPResponsePtr> &promise,
+        const HTTPResponse *response) {
+    promise.SetValue(HTTPClient::HTTPResponsePtr(
+                response == NULL ? NULL : new HTTPResponse(*response)));
+}
+
+::cube::Future<HTTPClient::HTTPResponsePtr> HTTPClient::Send(
+        const ::cube::net::InetAddr &addr,
+        const HTTPRequest &request,
+        int64_t timeout_ms /* = 2000 */) {
+    ::cube::Promise<HTTPResponsePtr> promise;
+    ::cube::Future<HTTPResponsePtr> future = promise.GetFuture();
+    if (Send(addr, request, std::bind(&SetResponse, promise, _1), timeout_ms) != CUBE_OK)
+        promise.SetValue(HTTPResponsePtr());
+    return future;
+}
+
+::cube::Future<HTTPClient::HTTPResponsePtr> HTTPClient::Get(
+        const ::cube::net::InetAddr &addr,
+        const std::string &url,
+        int64_t timeout_ms /* = 2000 */) {
+    HTTPRequest request;
+    request.SetURL(url);
+
+    return Send(addr, request, timeout_ms);
+}
+
+::cube::Future<HTTPClient::HTTPResponsePtr> HTTPClient::Post(
+        const ::cube::net::InetAddr &addr,
+        const std::string &url,
+        const std::string &body,
+        int64_t timeout_ms /* = 2000 */) {
+    HTTPRequest request;
+    request.SetURL(url);
+    request.SetMethod("POST");
+    if (body.length() > 0)
+        request.Write(body);
+
+    return Send(addr, request, timeout_ms);
+}
+
 void HTTPClient::OnResponse(const ResponseCallback &callback, HTTPClientConnectionPtr conn, const HTTPResponse *response) {
     // remove from requesting connections
     m_requesting_conns.erase(conn->Id());
@@ -4,7 +4,9 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
 
+#include "base/future.h"
 #include "net/tcp_connection.h"
 #include "http_cli_connection.h"
 #include "http_request.h"
@@ -18,6 +20,8 @@ class HTTPClient {
         static const size_t DEFAULT_MAX_IDLE_CONNS_NUMBER = 16;
 
         typedef std::function<void(const HTTPResponse *)> ResponseCallback;
+        // NULL when the request failed or timed out
+        typedef std::unique_ptr<HTTPResponse> HTTPResponsePtr;
 
         HTTPClient(::cube::net::EventLoop *event_loop);
         ~HTTPClient();
@@ -41,7 +45,21 @@ class HTTPClient {
                 const ResponseCallback &callback,
                 int64_t timeout_ms = 2000);
 
- 
+        // same as above, but return a future of the response,
+        // which must be used in the thread of event_loop
+        ::cube::Future<HTTPResponsePtr> Send(const ::cube::net::InetAddr &addr,
+                const HTTPRequest &request,
+                int64_t timeout_ms = 2000);
+
+        ::cube::Future<HTTPResponsePtr> Get(const ::cube::net::InetAddr &addr,
+                const std::string &url,
+                int64_t timeout_ms = 2000);
+
+        ::cube::Future<HTTPResponsePtr> Post(const ::cube::net::InetAddr &addr,
+                const std::string &url,
+                const std::string &body,
+                int64_t timeout_ms = 2000);
+
     private:
         HTTPClientConnectionPtr GetConn(const ::cube::net::InetAddr &addr);
         void PutConn(HTTPClientConnectionPtr conn);
@@ -65,45 +65,10 @@ void HTTPConnection::OnHeaders(::cube::net::TcpConnectionPtr conn, Buffer *buffe
 }
 
 bool HTTPConnection::ParseHeaders(Buffer *buffer) {
-    const std::string debug_str(buffer->Peek(), buffer->ReadableBytes());
-    const char *eoh = buffer->Find("\r\n\r\n");
-    if (eoh == NULL) {
-        M_LOG_ERROR("can not find CRLFCRLF");
+    // found by ReadUntil
+    const char *eoh = m_conn->FoundDelimiter();
+    if (!m_request.ParseHeaders(buffer->Peek(), eoh))
         return false;
-    }
-
-    const std::string header_str(buffer->Peek(), eoh - buffer->Peek());
-    std::vector<std::string> lines;
-    ::cube::strings::Split(header_str, "\r\n", lines);
-    if (lines.empty()) {
-        M_LOG_ERROR("no request line");
-        return false;
-    }
-
-    // request line
-    // Method URL Proto
-    std::vector<std::string> fields;
-    ::cube::strings::Split(lines[0], " ", fields);
-    if (fields.size() != 3) {
-        M_LOG_ERROR("request line format invalid, \"%s\"", lines[0].c_str());
-        return false;
-    }
-    m_request.SetMethod(fields[0]);
-    m_request.SetURL(fields[1]);
-    m_request.SetProto(fields[2]);
-    
-    // headers
-    for (size_t i = 1; i < lines.size(); i++) {
-        const std::string line = lines[i];
-        size_t colon = line.find(':');
-        if (colon == std::string::npos)
-            continue;
-        std::string key = line.substr(0, colon);
-        std::string value = line.substr(colon + 1);
-        cube::strings::Trim(key);
-        cube::strings::Trim(value);
-        m_request.SetHeader(key, value);
-    }
     buffer->RetrieveUntil(eoh + 4);
     return true;
 }
@@ -13,6 +13,42 @@ HTTPRequest::HTTPRequest() {
 HTTPRequest::~HTTPRequest() {
 }
 
+bool HTTPRequest::ParseHeaders(const char *begin, const char *end) {
+    const std::string header_str(begin, end - begin);
+    std::vector<std::string> lines;
+    ::cube::strings::Split(header_str, "\r\n", lines);
+    if (lines.empty()) {
+        M_LOG_ERROR("no request line");
+        return false;
+    }
+
+    // request line
+    // Method URL Proto
+    std::vector<std::string> fields;
+    ::cube::strings::Split(lines[0], " ", fields);
+    if (fields.size() != 3) {
+        M_LOG_ERROR("request line format invalid, \"%s\"", lines[0].c_str());
+        return false;
+    }
+    SetMethod(fields[0]);
+    SetURL(fields[1]);
+    SetProto(fields[2]);
+
+    // headers
+    for (size_t i = 1; i < lines.size(); i++) {
+        const std::string line = lines[i];
+        size_t colon = line.find(':');
+        if (colon == std::string::npos)
+            continue;
+        std::string key = line.substr(0, colon);
+        std::string value = line.substr(colon + 1);
+        cube::strings::Trim(key);
+        cube::strings::Trim(value);
+        SetHeader(key, value);
+    }
+    return true;
+}
+
 bool HTTPRequest::KeepAlive() const {
     const std::string value = Header("Connection");
 
@@ -63,6 +63,10 @@ class HTTPRequest {
 
         std::string ToString() const;
 
+        // parse request line and headers in [begin, end),
+        // end points to the CRLFCRLF
+        bool ParseHeaders(const char *begin, const char *end);
+
         ParseState State() const { return m_parse_state; }
         void SetState(ParseState state) { m_parse_state = state; }
 
@@ -20,6 +20,20 @@ class HTTPServer {
 
         const ::cube::net::InetAddr &ServerAddr() const { return m_server.ServerAddr(); }
 
+        // number of io threads, must be called before Start()
+        // RequestCallback is invoked in io threads when thread_num > 0
+        void SetThreadNum(size_t thread_num) { m_server.SetThreadNum(thread_num); }
+        void SetLoadBalance(::cube::net::TcpServer::LoadBalance load_balance)
+        { m_server.SetLoadBalance(load_balance); }
+        void SetThreadInitCallback(const ::cube::net::EventLoopThreadPool::ThreadInitCallback &cb)
+        { m_server.SetThreadInitCallback(cb); }
+        void SetPollerType(::cube::net::Poller::Type poller_type) { m_server.SetPollerType(poller_type); }
+        void SetReusePort(bool on) { m_server.SetReusePort(on); }
+        void SetEdgeTriggered(bool on) { m_server.SetEdgeTriggered(on); }
+        void SetBacklog(int backlog) { m_server.SetBacklog(backlog); }
+        void SetCpuAffinity(const std::vector<int> &cpus) { m_server.SetCpuAffinity(cpus); }
+        void SetNumaLocal(bool on) { m_server.SetNumaLocal(on); }
+
         bool KeepAlive() const { return m_enable_keepalive; }
         void SetKeepAlive(bool on) { m_enable_keepalive = on; }
 
@@ -0,0 +1,265 @@
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <errno.h>
+#include <string.h>
+#include <assert.h>
+#include <unistd.h> // ::close
+
+#include "base/logging.h"
+#include "io_uring_poller.h"
+#include "event_loop.h"
+#include "eventor.h"
+
+namespace cube {
+
+namespace net {
+
+// user_data of IORING_OP_POLL_REMOVE, its completion is ignored
+static const uint64_t REMOVE_USER_DATA = 0;
+
+static int IoUringSetup(unsigned entries, struct io_uring_params *params) {
+    return ::syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int IoUringEnter(int ring_fd, unsigned to_submit, unsigned min_complete,
+        unsigned flags, const void *arg, size_t argsz) {
+    return ::syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+IoUringPoller::IoUringPoller(EventLoop *event_loop)
+    : Poller(event_loop),
+    m_ring_fd(-1),
+    m_sq_ptr(MAP_FAILED), m_sq_size(0),
+    m_sq_head(NULL), m_sq_tail(NULL), m_sq_mask(NULL), m_sq_array(NULL),
+    m_sqes((struct io_uring_sqe *)MAP_FAILED), m_sqes_size(0),
+    m_sq_local_tail(0), m_to_submit(0),
+    m_cq_ptr(MAP_FAILED), m_cq_size(0),
+    m_cq_head(NULL), m_cq_tail(NULL), m_cq_mask(NULL), m_cqes(NULL) {
+}
+
+IoUringPoller::~IoUringPoller() {
+    if (m_sqes != MAP_FAILED)
+        ::munmap(m_sqes, m_sqes_size);
+    if (m_cq_ptr != MAP_FAILED && m_cq_ptr != m_sq_ptr)
+        ::munmap(m_cq_ptr, m_cq_size);
+    if (m_sq_ptr != MAP_FAILED)
+        ::munmap(m_sq_ptr, m_sq_size);
+    if (m_ring_fd >= 0)
+        ::close(m_ring_fd);
+}
+
+bool IoUringPoller::Init() {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    m_ring_fd = IoUringSetup(RING_ENTRIES, &params);
+    if (m_ring_fd < 0) {
+        M_LOG_WARN("io_uring_setup failed, errno=%d", errno);
+        return false;
+    }
+    // need a single mmap for both rings and timeout in io_uring_enter
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG)) {
+        M_LOG_WARN("io_uring features[%u] not supported", params.features);
+        return false;
+    }
+
+    m_sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (m_cq_size > m_sq_size)
+        m_sq_size = m_cq_size;
+    m_cq_size = m_sq_size;
+
+    m_sq_ptr = ::mmap(NULL, m_sq_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQ_RING);
+    if (m_sq_ptr == MAP_FAILED)
+        return false;
+    m_cq_ptr = m_sq_ptr;
+
+    m_sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    m_sqes = (struct io_uring_sqe *)::mmap(NULL, m_sqes_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQES);
+    if (m_sqes == MAP_FAILED)
+        return false;
+
+    char *sq = (char *)m_sq_ptr;
+    m_sq_head = (unsigned *)(sq + params.sq_off.head);
+    m_sq_tail = (unsigned *)(sq + params.sq_off.tail);
+    m_sq_mask = (unsigned *)(sq + params.sq_off.ring_mask);
+    m_sq_array = (unsigned *)(sq + params.sq_off.array);
+    m_sq_local_tail = *m_sq_tail;
+
+    char *cq = (char *)m_cq_ptr;
+    m_cq_head = (unsigned *)(cq + params.cq_off.head);
+    m_cq_tail = (unsigned *)(cq + params.cq_off.tail);
+    m_cq_mask = (unsigned *)(cq + params.cq_off.ring_mask);
+    m_cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+    return true;
+}
+
+IoUringPoller::FdState &IoUringPoller::GetFdState(int fd) {
+    assert(fd >= 0);
+    if (static_cast<size_t>(fd) >= m_fd_states.size()) {
+        FdState state = { NULL, 0, 1, false, false };
+        m_fd_states.resize(fd + 1, state);
+    }
+    return m_fd_states[fd];
+}
+
+void IoUringPoller::MarkDirty(int fd) {
+    FdState &state = GetFdState(fd);
+    if (!state.dirty) {
+        state.dirty = true;
+        m_dirty_fds.push_back(fd);
+    }
+}
+
+bool IoUringPoller::UpdateEvents(Eventor *eventor) {
+    m_event_loop->AssertInLoopThread();
+    FdState &state = GetFdState(eventor->Fd());
+    state.eventor = eventor;
+    MarkDirty(eventor->Fd());
+    return true;
+}
+
+bool IoUringPoller::RemoveEvents(Eventor *eventor) {
+    m_event_loop->AssertInLoopThread();
+    FdState &state = GetFdState(eventor->Fd());
+    if (state.eventor == NULL)
+        return true;
+
+    // cancel the poll now, fd may be closed and reused before next Poll()
+    if (state.armed) {
+        PrepPollRemove(UserData(eventor->Fd(), state.gen));
+        state.armed = false;
+    }
+    state.eventor = NULL;
+    if (++state.gen == 0) state.gen = 1;
+    return true;
+}
+
+void IoUringPoller::ApplyChanges() {
+    for (size_t i = 0; i < m_dirty_fds.size(); i++) {
+        int fd = m_dirty_fds[i];
+        FdState &state = m_fd_states[fd];
+        state.dirty = false;
+        if (state.eventor == NULL)
+            continue;
+
+        uint32_t events = state.eventor->Events();
+        if (state.armed && state.armed_events == events)
+            continue;
+
+        if (state.armed) {
+            PrepPollRemove(UserData(fd, state.gen));
+            state.armed = false;
+            if (++state.gen == 0) state.gen = 1;
+        }
+        if (events != POLLNONE) {
+            PrepPollAdd(fd, events, UserData(fd, state.gen));
+            state.armed = true;
+            state.armed_events = events;
+        }
+    }
+    m_dirty_fds.clear();
+}
+
+struct io_uring_sqe *IoUringPoller::GetSqe() {
+    unsigned head = __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+    if (m_sq_local_tail - head > *m_sq_mask) {
+        // submission queue is full, submit without waiting
+        Enter(m_to_submit, 0, 0);
+    }
+    unsigned idx = m_sq_local_tail & *m_sq_mask;
+    struct io_uring_sqe *sqe = &m_sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    m_sq_array[idx] = idx;
+    m_sq_local_tail++;
+    m_to_submit++;
+    return sqe;
+}
+
+void IoUringPoller::PrepPollAdd(int fd, uint32_t events, uint64_t user_data) {
+    struct io_uring_sqe *sqe = GetSqe();
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->poll32_events = events;
+    sqe->user_data = user_data;
+}
+
+void IoUringPoller::PrepPollRemove(uint64_t user_data) {
+    struct io_uring_sqe *sqe = GetSqe();
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = user_data;
+    sqe->user_data = REMOVE_USER_DATA;
+}
+
+int IoUringPoller::Enter(unsigned to_submit, unsigned min_complete, int timeout_ms) {
+    // publish sqes
+    __atomic_store_n(m_sq_tail, m_sq_local_tail, __ATOMIC_RELEASE);
+    m_to_submit = 0;
+
+    unsigned flags = 0;
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    memset(&arg, 0, sizeof(arg));
+    if (min_complete > 0) {
+        flags |= IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+        if (timeout_ms >= 0) {
+            ts.tv_sec = timeout_ms / 1000;
+            ts.tv_nsec = (timeout_ms % 1000) * 1000 * 1000;
+            arg.ts = (uint64_t)(uintptr_t)&ts;
+        }
+    }
+    int ret = 0;
+    do {
+        ret = IoUringEnter(m_ring_fd, to_submit, min_complete, flags,
+                (flags & IORING_ENTER_EXT_ARG) ? &arg : NULL,
+                (flags & IORING_ENTER_EXT_ARG) ? sizeof(arg) : 0);
+    } while (ret < 0 && errno == EINTR && min_complete == 0);
+    return ret;
+}
+
+void IoUringPoller::Poll(int timeout_ms, std::vector<Eventor *> &eventors) {
+    eventors.clear();
+
+    // submit interest changes and wait in one syscall
+    ApplyChanges();
+    unsigned head = __atomic_load_n(m_cq_head, __ATOMIC_RELAXED);
+    bool ready = head != __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+    if (!ready && timeout_ms != 0) {
+        Enter(m_to_submit, 1, timeout_ms);
+    } else if (m_to_submit > 0) {
+        Enter(m_to_submit, 0, 0);
+    }
+
+    unsigned tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+    for (; head != tail; head++) {
+        const struct io_uring_cqe *cqe = &m_cqes[head & *m_cq_mask];
+        if (cqe->user_data == REMOVE_USER_DATA)
+            continue;
+
+        int fd = static_cast<int>(cqe->user_data & 0xffffffff);
+        uint32_t gen = static_cast<uint32_t>(cqe->user_data >> 32);
+        if (static_cast<size_t>(fd) >= m_fd_states.size())
+            continue;
+        FdState &state = m_fd_states[fd];
+        // stale completion of removed or updated poll
+        if (state.eventor == NULL || state.gen != gen || !state.armed)
+            continue;
+        if (cqe->res == -ECANCELED)
+            continue;
+
+        // one-shot poll, rearm it in next Poll()
+        state.armed = false;
+        MarkDirty(fd);
+
+        state.eventor->SetRevents(cqe->res < 0 ? (uint32_t)POLLERR : (uint32_t)cqe->res);
+        eventors.push_back(state.eventor);
+    }
+    __atomic_store_n(m_cq_head, head, __ATOMIC_RELEASE);
+}
+
+}
+
+}
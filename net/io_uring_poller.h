@@ -0,0 +1,91 @@
+#ifndef __CUBE_IO_URING_POLLER_H__
+#define __CUBE_IO_URING_POLLER_H__
+
+#include <stdint.h>
+#include <vector>
+
+#include "poller.h"
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+namespace cube {
+
+namespace net {
+
+// Poller based on io_uring one-shot IORING_OP_POLL_ADD.
+// Interest changes are only recorded in UpdateEvents/RemoveEvents,
+// and submitted in a batch together with waiting for completions,
+// so one io_uring_enter is issued per Poll() in most cases.
+// Polls are rearmed after completion to keep level-triggered semantics.
+class IoUringPoller : public Poller {
+    public:
+        static const unsigned RING_ENTRIES = 1024;
+
+        IoUringPoller(EventLoop *event_loop);
+        virtual ~IoUringPoller();
+
+        // return false when io_uring is not supported
+        bool Init();
+
+        virtual Type GetType() const { return Type_IoUring; }
+
+        virtual bool UpdateEvents(Eventor *eventor);
+        virtual bool RemoveEvents(Eventor *eventor);
+
+        virtual void Poll(int timeout_ms, std::vector<Eventor *> &active_eventors);
+
+    private:
+        struct FdState {
+            Eventor *eventor;
+            uint32_t armed_events;
+            uint32_t gen;   // to drop completions of stale polls
+            bool armed;
+            bool dirty;
+        };
+
+        FdState &GetFdState(int fd);
+        void MarkDirty(int fd);
+        void ApplyChanges();
+
+        struct io_uring_sqe *GetSqe();
+        void PrepPollAdd(int fd, uint32_t events, uint64_t user_data);
+        void PrepPollRemove(uint64_t user_data);
+        int Enter(unsigned to_submit, unsigned min_complete, int timeout_ms);
+
+        static uint64_t UserData(int fd, uint32_t gen) {
+            return (static_cast<uint64_t>(gen) << 32) | static_cast<uint32_t>(fd);
+        }
+
+    private:
+        int m_ring_fd;
+
+        // submission queue
+        void *m_sq_ptr;
+        size_t m_sq_size;
+        unsigned *m_sq_head;
+        unsigned *m_sq_tail;
+        unsigned *m_sq_mask;
+        unsigned *m_sq_array;
+        struct io_uring_sqe *m_sqes;
+        size_t m_sqes_size;
+        unsigned m_sq_local_tail;
+        unsigned m_to_submit;
+
+        // completion queue
+        void *m_cq_ptr;
+        size_t m_cq_size;
+        unsigned *m_cq_head;
+        unsigned *m_cq_tail;
+        unsigned *m_cq_mask;
+        struct io_uring_cqe *m_cqes;
+
+        std::vector<FdState> m_fd_states;
+        std::vector<int> m_dirty_fds;
+};
+
+}
+
+}
+
+#endif
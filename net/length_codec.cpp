@@ -0,0 +1,106 @@
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+#include <algorithm>
+
+#include "base/buffer.h"
+#include "base/logging.h"
+
+#include "length_codec.h"
+#include "tcp_connection.h"
+
+using namespace std::placeholders;
+
+namespace cube {
+
+namespace net {
+
+const size_t LengthCodec::DEFAULT_MAX_FRAME_BYTES;
+const size_t LengthCodec::MAX_FRAME_BYTES;
+const size_t LengthCodec::SMALL_FRAME_BYTES;
+
+LengthCodec::LengthCodec(const FrameCallback &cb, size_t length_bytes, size_t max_frame_bytes)
+    : m_frame_callback(cb),
+    m_length_bytes(length_bytes),
+    m_max_frame_bytes(std::min(max_frame_bytes, MAX_FRAME_BYTES)) {
+    assert(length_bytes == 1 || length_bytes == 2 || length_bytes == 4 || length_bytes == 8);
+    assert(max_frame_bytes <= MAX_FRAME_BYTES);
+}
+
+void LengthCodec::Start(const TcpConnectionPtr &conn) {
+    conn->ReadBytes(m_length_bytes, std::bind(&LengthCodec::OnRead, this, _1, _2));
+}
+
+bool LengthCodec::Send(const TcpConnectionPtr &conn, const char *data, size_t len) {
+    char header[8];
+    if (!EncodeLength(header, len)) {
+        M_LOG_ERROR("conn[%lu] frame of %zu bytes does not fit in %zu bytes length",
+                conn->Id(), len, m_length_bytes);
+        return false;
+    }
+    if (len <= SMALL_FRAME_BYTES) {
+        // one write for small frames
+        char frame[sizeof(header) + SMALL_FRAME_BYTES];
+        memcpy(frame, header, m_length_bytes);
+        memcpy(frame + m_length_bytes, data, len);
+        return conn->Write(frame, m_length_bytes + len);
+    }
+    return conn->Write(header, m_length_bytes) && conn->Write(data, len);
+}
+
+bool LengthCodec::Send(const TcpConnectionPtr &conn, ::cube::Buffer *body) {
+    char header[8];
+    if (!EncodeLength(header, body->ReadableBytes())) {
+        M_LOG_ERROR("conn[%lu] frame of %zu bytes does not fit in %zu bytes length",
+                conn->Id(), body->ReadableBytes(), m_length_bytes);
+        return false;
+    }
+    body->Prepend(header, m_length_bytes);
+    bool succ = conn->Write(body->Peek(), body->ReadableBytes());
+    body->RetrieveAll();
+    return succ;
+}
+
+void LengthCodec::OnRead(TcpConnectionPtr conn, ::cube::Buffer *buffer) {
+    // deliver all complete frames, then wait for the rest of the next one
+    size_t need = m_length_bytes;
+    while (buffer->ReadableBytes() >= m_length_bytes) {
+        size_t len = PeekLength(buffer);
+        if (len > m_max_frame_bytes) {
+            M_LOG_ERROR("conn[%lu] frame of %zu bytes is too large", conn->Id(), len);
+            conn->Close();
+            return;
+        }
+        if (buffer->ReadableBytes() < m_length_bytes + len) {
+            need = m_length_bytes + len;
+            break;
+        }
+        m_frame_callback(conn, buffer->Peek() + m_length_bytes, len);
+        if (conn->Closed())
+            return;
+        buffer->Retrieve(m_length_bytes + len);
+    }
+    conn->ReadBytes(need, std::bind(&LengthCodec::OnRead, this, _1, _2));
+}
+
+size_t LengthCodec::PeekLength(::cube::Buffer *buffer) const {
+    switch (m_length_bytes) {
+        case 1: return static_cast<uint8_t>(buffer->PeekInt8());
+        case 2: return static_cast<uint16_t>(buffer->PeekInt16());
+        case 4: return static_cast<uint32_t>(buffer->PeekInt32());
+        default: return static_cast<uint64_t>(buffer->PeekInt64());
+    }
+}
+
+bool LengthCodec::EncodeLength(char *header, size_t len) const {
+    if (m_length_bytes < 8 && (len >> (m_length_bytes * 8)) != 0)
+        return false;
+    // big-endian, the low m_length_bytes bytes of len
+    for (size_t i = 0; i < m_length_bytes; i++)
+        header[i] = static_cast<char>(len >> ((m_length_bytes - 1 - i) * 8));
+    return true;
+}
+
+}
+
+}
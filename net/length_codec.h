@@ -0,0 +1,74 @@
+#ifndef __CUBE_LENGTH_CODEC_H__
+#define __CUBE_LENGTH_CODEC_H__
+
+#include <limits.h>
+#include <functional>
+
+#include "callbacks.h"
+
+namespace cube {
+
+namespace net {
+
+// frames of a length field followed by a body:
+// +--------+------------------+
+// | length |   body (length)  |
+// +--------+------------------+
+// the length field is 1, 2, 4 or 8 bytes in network byte order.
+// one codec can serve all connections of a server and must outlive them.
+// every complete frame in the input buffer is delivered in one read,
+// then ReadBytes waits for the rest of the next frame.
+class LengthCodec {
+    public:
+        // data points into the input buffer, valid only in the callback
+        typedef std::function<void(TcpConnectionPtr, const char *data, size_t len)> FrameCallback;
+
+        // frames up to max_frame_bytes are buffered whole in the input
+        // buffer of a connection, raising it costs memory per connection
+        static const size_t DEFAULT_MAX_FRAME_BYTES = 1024 * 1024;
+        // length field and body must fit in int of ReadBytes
+        static const size_t MAX_FRAME_BYTES = INT_MAX - 8;
+        // frames up to this size are written with one copy to the stack,
+        // larger ones with separate writes of the header and body
+        static const size_t SMALL_FRAME_BYTES = 512;
+
+        // max_frame_bytes must not exceed MAX_FRAME_BYTES
+        explicit LengthCodec(const FrameCallback &cb, size_t length_bytes = 4,
+                size_t max_frame_bytes = DEFAULT_MAX_FRAME_BYTES);
+
+        // start reading frames of conn, e.g. in its connection callback.
+        // conn is closed when a frame is larger than max_frame_bytes
+        void Start(const TcpConnectionPtr &conn);
+
+        // write data as a frame
+        bool Send(const TcpConnectionPtr &conn, const char *data, size_t len);
+        // write the readable bytes of body as a frame, the length field is
+        // put in the prepend space of body without copying, body is drained
+        bool Send(const TcpConnectionPtr &conn, ::cube::Buffer *body);
+
+        size_t LengthBytes() const { return m_length_bytes; }
+
+    private:
+        void OnRead(TcpConnectionPtr conn, ::cube::Buffer *buffer);
+
+        size_t PeekLength(::cube::Buffer *buffer) const;
+        // write len to header in network byte order,
+        // return false when it does not fit in the length field
+        bool EncodeLength(char *header, size_t len) const;
+
+    private:
+        // noncopyable
+        LengthCodec(const LengthCodec &) = delete;
+        LengthCodec &operator=(const LengthCodec &) = delete;
+
+    private:
+        FrameCallback m_frame_callback;
+        const size_t m_length_bytes;
+        const size_t m_max_frame_bytes;
+};
+
+}
+
+}
+
+#endif
@@ -3,7 +3,6 @@
 
 #include <sys/epoll.h>
 #include <vector>
-#include <map>
 
 namespace cube {
 
@@ -12,37 +11,38 @@ namespace net {
 class EventLoop;
 class Eventor;
 
+// interface of io multiplexing backends
 class Poller {
     public:
-        static const int EPOLL_EVENT_SIZE = 1024;
-
         enum {
             POLLNONE = 0,
             POLLIN = EPOLLIN,
             POLLOUT = EPOLLOUT,
             POLLERR = EPOLLERR,
             POLLHUB = EPOLLHUP,
+            POLLET = EPOLLET,   // only supported by epoll
         };
 
-        Poller(EventLoop *event_loop);
-        ~Poller();
+        enum Type {
+            Type_Epoll,
+            Type_IoUring,
+        };
 
-        bool UpdateEvents(Eventor *eventor);
-        bool RemoveEvents(Eventor *eventor);
+        // fall back to epoll when io_uring is not supported
+        static Poller *Create(EventLoop *event_loop, Type type);
 
-        void Poll(int timeout_ms, std::vector<Eventor *> &active_eventors);
+        Poller(EventLoop *event_loop) : m_event_loop(event_loop) {}
+        virtual ~Poller() {}
 
-    private:
-        bool EpollOperate(int operation, Eventor *eventor);
+        virtual Type GetType() const = 0;
 
-    private:
+        virtual bool UpdateEvents(Eventor *eventor) = 0;
+        virtual bool RemoveEvents(Eventor *eventor) = 0;
 
-        EventLoop *m_event_loop;
+        virtual void Poll(int timeout_ms, std::vector<Eventor *> &active_eventors) = 0;
 
-        int m_epoll_fd;
-        struct epoll_event m_epoll_events[EPOLL_EVENT_SIZE];
-
-        std::map<int, Eventor *> m_eventors;
+    protected:
+        EventLoop *m_event_loop;
 };
 
 }
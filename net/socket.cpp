@@ -109,6 +109,13 @@ bool SetReuseAddr(int sockfd, bool on) {
     return true;
 }
 
+bool SetReusePort(int sockfd, bool on) {
+    int val = on ? 1 : 0;
+    if (::setsockopt(sockfd, SOL_SOCKET, SO_REUSEPORT, &val, sizeof(val)))
+        return false;
+    return true;
+}
+
 bool SetKeepAlive(int sockfd, bool on) {
     int val = on ? 1 : 0;
     if (::setsockopt(sockfd, SOL_SOCKET, SO_KEEPALIVE, &val, sizeof(val)))
@@ -116,6 +123,12 @@ bool SetKeepAlive(int sockfd, bool on) {
     return true;
 }
 
+bool SetBusyPoll(int sockfd, int usec) {
+    if (::setsockopt(sockfd, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec)))
+        return false;
+    return true;
+}
+
 bool SetRecvBuffSize(int sockfd, int size) {
     if (::setsockopt(sockfd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)))
         return false;
@@ -128,6 +141,20 @@ bool SetSendBuffSize(int sockfd, int size) {
     return true;
 }
 
+bool SetIncomingCpu(int sockfd, int cpu) {
+    if (::setsockopt(sockfd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, sizeof(cpu)))
+        return false;
+    return true;
+}
+
+int GetIncomingCpu(int sockfd) {
+    int cpu = -1;
+    socklen_t len = sizeof(cpu);
+    if (::getsockopt(sockfd, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len))
+        return -1;
+    return cpu;
+}
+
 int GetSocketError(int sockfd, int &saved_error) {
     int error = 0;
     socklen_t error_len = sizeof(error);
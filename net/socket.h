@@ -17,9 +17,14 @@ bool SetNonBlocking(int sockfd, bool on);
 bool SetNoDelay(int sockfd, bool on);
 bool SetQuickAck(int sockfd, bool on);
 bool SetReuseAddr(int sockfd, bool on);
+bool SetReusePort(int sockfd, bool on);
 bool SetKeepAlive(int sockfd, bool on);
+bool SetBusyPoll(int sockfd, int usec);
 bool SetRecvBuffSize(int sockfd, int size);
 bool SetSendBuffSize(int sockfd, int size);
+bool SetIncomingCpu(int sockfd, int cpu);
+// cpu that received the last packet of sockfd, -1 on error
+int GetIncomingCpu(int sockfd);
 int GetSocketError(int sockfd, int &saved_errno);
 
 InetAddr GetLocalAddr(int sockfd);
@@ -42,9 +47,12 @@ class Socket {
         bool SetNoDelay(bool on) { return sockets::SetNoDelay(m_sockfd, on); }
         bool SetQuickAck(bool on) { return sockets::SetQuickAck(m_sockfd, on); }
         bool SetReuseAddr(bool on) { return sockets::SetReuseAddr(m_sockfd, on); }
+        bool SetReusePort(bool on) { return sockets::SetReusePort(m_sockfd, on); }
         bool SetKeepAlive(bool on) { return sockets::SetKeepAlive(m_sockfd, on); }
+        bool SetBusyPoll(int usec) { return sockets::SetBusyPoll(m_sockfd, usec); }
         bool SetRecvBuffSize(int size) { return sockets::SetRecvBuffSize(m_sockfd, size); }
         bool SetSendBuffSize(int size) { return sockets::SetSendBuffSize(m_sockfd, size); }
+        bool SetIncomingCpu(int cpu) { return sockets::SetIncomingCpu(m_sockfd, cpu); }
 
     private:
         const int m_sockfd;
@@ -1,8 +1,11 @@
 #include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/sendfile.h>
+#include <algorithm>
 
 #include "tcp_connection.h"
 
-#include "base/time_util.h"
 #include "base/logging.h"
 #include "base/strings.h"
 #include "event_loop.h"
@@ -19,6 +22,87 @@ static void DefaultConnectionCallback(const TcpConnectionPtr &conn) {
     // do nothing
 }
 
+// read or write callback of a TcpAwaiter, it resumes the coroutine when called.
+// when dropped without being called, e.g. the connection is closed,
+// the coroutine is resumed later in this iteration, never inside the
+// connection code which is dropping it.
+class TcpResumer {
+    public:
+        explicit TcpResumer(TcpAwaiter *awaiter) : m_awaiter(awaiter) {}
+        TcpResumer(TcpResumer &&other) noexcept : m_awaiter(other.m_awaiter) {
+            other.m_awaiter = NULL;
+        }
+        ~TcpResumer() {
+            if (m_awaiter) {
+                m_awaiter->m_buffer = NULL;
+                m_awaiter->m_done = false;
+                m_awaiter->m_conn->GetEventLoop()->Defer(std::move(m_awaiter->m_resume));
+            }
+        }
+
+        // no-op once resumed
+        void operator()(TcpConnectionPtr conn, ::cube::Buffer *buffer) {
+            if (m_awaiter == NULL) return;
+            m_awaiter->m_buffer = buffer;
+            Resume();
+        }
+        void operator()(TcpConnectionPtr conn) {
+            if (m_awaiter == NULL) return;
+            m_awaiter->m_done = true;
+            Resume();
+        }
+
+    private:
+        void Resume() {
+            TcpAwaiter *awaiter = m_awaiter;
+            m_awaiter = NULL;
+            awaiter->m_resume();
+        }
+
+    private:
+        TcpAwaiter *m_awaiter;
+};
+
+bool ReadAwaiter::await_ready() {
+    if (m_conn->Closed())
+        return true;
+    // no suspension when the data is read already
+    ::cube::Buffer *input = &m_conn->m_input_buffer;
+    if (m_delimiter.empty() ? input->ReadableBytes() >= m_read_bytes
+            : m_conn->FindDelimiter(m_delimiter, 0)) {
+        m_buffer = input;
+        return true;
+    }
+    return false;
+}
+
+void ReadAwaiter::Suspend() {
+    if (m_delimiter.empty())
+        m_conn->ReadBytes(m_read_bytes, TcpResumer(this));
+    else
+        m_conn->WaitDelimiter(m_delimiter, TcpResumer(this));
+}
+
+bool WriteAwaiter::await_ready() {
+    if (!m_conn->Write(m_data, m_len))
+        return true;
+    // no suspension when all data is written directly
+    if (!m_conn->OutputPending()) {
+        m_done = true;
+        return true;
+    }
+    return false;
+}
+
+void WriteAwaiter::Suspend() {
+    m_conn->m_write_complete_callback = TcpResumer(this);
+}
+
+const size_t TcpConnection::MIN_READ_SIZE;
+const size_t TcpConnection::MAX_READ_SIZE;
+const size_t TcpConnection::CHAINED_READ_BYTES;
+const size_t TcpConnection::MIN_SLICE_BYTES;
+
 uint64_t TcpConnection::m_next_conn_id(1);
 
 TcpConnection::TcpConnection(EventLoop *event_loop,
@@ -33,14 +117,31 @@ TcpConnection::TcpConnection(EventLoop *event_loop,
     m_local_addr(local_addr),
     m_peer_addr(peer_addr),
     m_state(ConnState_Connecting),
+    m_edge_triggered(false),
+    m_input_buffer(event_loop->GetSlabPool()),
+    m_input_chain(event_loop->GetSlabPool()),
+    m_output_buffer(event_loop->GetSlabPool()),
+    m_writev_batch(::cube::ChainBuffer::DEFAULT_IOVECS),
+    m_output_written(0),
+    m_read_scanned(0),
+    m_delimiter_offset(0),
     m_read_bytes(-1),
-    m_last_active_time(TimeUtil::CurrentTime()),
+    m_read_budget(0),
+    m_small_reads(0),
+    m_keep_capacity(0),
+    m_last_active_time(event_loop->NowMillis()),
     m_connection_callback(std::bind(&DefaultConnectionCallback, std::placeholders::_1)) {
 
     m_eventor->SetEventsCallback(std::bind(&TcpConnection::HandleEvents, this, _1));
 
+    m_input_buffer.SetKeepCapacity(m_keep_capacity);
+    memset(&m_read_stats, 0, sizeof(m_read_stats));
+    m_read_stats.read_size = MIN_READ_SIZE;
+
     m_sock->SetKeepAlive(true);
     m_sock->SetNonBlocking(true);
+    if (m_event_loop->SockBusyPollUs() > 0)
+        m_sock->SetBusyPoll(m_event_loop->SockBusyPollUs());
 }
 
 TcpConnection::~TcpConnection() {
@@ -51,93 +152,171 @@ TcpConnection::~TcpConnection() {
         Close();
 }
 
-void TcpConnection::ReadAny(const ReadCallback &cb) {
-    return ReadBytes(1, cb);
+void TcpConnection::ReadAny(ReadCallback cb) {
+    return ReadBytes(1, std::move(cb));
 }
 
-void TcpConnection::ReadBytes(size_t read_bytes, const ReadCallback &cb) {
+void TcpConnection::ReadBytes(size_t read_bytes, ReadCallback cb) {
     assert(cb);
     if (Closed()) return;
     if (m_input_buffer.ReadableBytes() >= read_bytes) {
-        m_event_loop->Post(std::bind(cb, shared_from_this(), &m_input_buffer));
+        m_event_loop->Defer(std::bind(std::move(cb), shared_from_this(), &m_input_buffer));
         return;
     }
+    // no space is reserved for read_bytes, it may come from the peer.
+    // the buffer grows with the adaptive read size as data arrives,
+    // or the data goes to m_input_chain when read_bytes is large
     m_read_bytes = read_bytes;
-    m_read_callback = cb;
+    m_read_callback = std::move(cb);
     if (!m_eventor->Reading()) {
         EnableReading();
     }
     return;
 }
 
-void TcpConnection::ReadUntil(const std::string &delimiter, const ReadCallback &cb) {
+void TcpConnection::ReadUntil(const std::string &delimiter, ReadCallback cb) {
     assert(cb);
     assert(!delimiter.empty());
     if (Closed()) return;
-    if (m_input_buffer.Find(delimiter) != NULL) {
-        m_event_loop->Post(std::bind(cb, shared_from_this(), &m_input_buffer));
+    if (FindDelimiter(delimiter, 0)) {
+        m_event_loop->Defer(std::bind(std::move(cb), shared_from_this(), &m_input_buffer));
         return;
     }
+    WaitDelimiter(delimiter, std::move(cb));
+}
+
+void TcpConnection::WaitDelimiter(const std::string &delimiter, ReadCallback cb) {
+    // the buffered bytes are searched already
     m_read_delimiter = delimiter;
-    m_read_callback = cb;
+    m_read_scanned = m_input_buffer.ReadableBytes();
+    m_read_callback = std::move(cb);
     if (!m_eventor->Reading()) {
         EnableReading();
     }
-    return;
+}
+
+bool TcpConnection::FindDelimiter(const std::string &delimiter, size_t from) {
+    const char *found = m_input_buffer.FindFrom(m_input_buffer.Peek() + from,
+            delimiter.data(), delimiter.data() + delimiter.size());
+    if (found == NULL)
+        return false;
+    m_delimiter_offset = found - m_input_buffer.Peek();
+    return true;
 }
 
 bool TcpConnection::Write(const std::string &str) {
-    return Write(str.data(), str.length(), NULL);
+    return Write(str.data(), str.length(), nullptr);
 }
 
 bool TcpConnection::Write(const char *data, size_t len) {
-    return Write(data, len, NULL);
+    return Write(data, len, nullptr);
 }
 
-bool TcpConnection::Write(const std::string &str, const WriteCompleteCallback &cb) {
-    return Write(str.data(), str.length(), cb);
+bool TcpConnection::Write(const std::string &str, WriteCompleteCallback cb) {
+    return Write(str.data(), str.length(), std::move(cb));
 }
 
-bool TcpConnection::Write(const char *data, size_t len, const WriteCompleteCallback &cb) {
-    // Not allow to send data when closed
+bool TcpConnection::Write(const char *data, size_t len, WriteCompleteCallback cb) {
+    ssize_t left = WriteDirectly(data, len, cb);
+    if (left <= 0)
+        return left == 0;
+
+    m_output_buffer.Append(data + len - left, left);
+    WaitWritable(std::move(cb));
+    return true;
+}
+
+bool TcpConnection::WriteFile(int fd, off_t offset, size_t len) {
+    return WriteFile(fd, offset, len, nullptr);
+}
+
+bool TcpConnection::WriteFile(int fd, off_t offset, size_t len, WriteCompleteCallback cb) {
     if (Closed()) {
         strings::FormatString(m_err_msg, "tcp connection[%lu] is closed", Id());
         return false;
     }
 
     if (len == 0) {
-        // It is always ok to send 0-length data
-        if (cb) {
-            m_event_loop->Post(std::bind(cb, shared_from_this()));
-        }
+        if (cb)
+            m_event_loop->Defer(std::bind(std::move(cb), shared_from_this()));
         return true;
     }
 
+    bool idle = m_state == ConnState_Connected && !OutputPending();
+    PendingFile file;
+    file.fd = fd;
+    file.offset = offset;
+    file.len = len;
+    file.position = m_output_written + m_output_buffer.ReadableBytes();
+    if (!m_pending_files)
+        m_pending_files.reset(new std::deque<PendingFile>());
+    m_pending_files->push_back(file);
+    WaitWritable(std::move(cb));
+    // a writable socket gives no more edge in edge-triggered mode
+    if (idle)
+        m_event_loop->Defer(std::bind(&TcpConnection::HandleWrite, shared_from_this()));
+    return true;
+}
+
+bool TcpConnection::Write(const SharedSlice &slice) {
+    return Write(slice, nullptr);
+}
+
+bool TcpConnection::Write(const SharedSlice &slice, WriteCompleteCallback cb) {
+    // small data is cheaper to copy than to chain
+    if (slice.Size() < MIN_SLICE_BYTES)
+        return Write(slice.Data(), slice.Size(), std::move(cb));
+
+    ssize_t left = WriteDirectly(slice.Data(), slice.Size(), cb);
+    if (left <= 0)
+        return left == 0;
+
+    m_output_buffer.Append(slice.Sub(slice.Size() - left, left));
+    WaitWritable(std::move(cb));
+    return true;
+}
+
+ssize_t TcpConnection::WriteDirectly(const char *data, size_t len, WriteCompleteCallback &cb) {
+    // Not allow to send data when closed
+    if (Closed()) {
+        strings::FormatString(m_err_msg, "tcp connection[%lu] is closed", Id());
+        return -1;
+    }
+
     // send data directly when no pending data to send
-    if (m_state == ConnState_Connected && m_output_buffer.ReadableBytes() == 0) {
-        int nwrote = ::write(m_eventor->Fd(), data, len);
+    if (len > 0 && m_state == ConnState_Connected && !OutputPending()) {
+        ssize_t nwrote = ::write(m_eventor->Fd(), data, len);
         if (nwrote < 0) {
             // send data directly failed
             // write data to output buffer and wait for POLLIN event
-        } else if (nwrote >= static_cast<int>(len)) {
-            // send all data directly
-            if (cb)
-                m_event_loop->Post(std::bind(cb, shared_from_this()));
-            return true;
         } else {
             // send some data directly but not all,
             // write the rest to output buffer
-            data += nwrote;
             len -= nwrote;
         }
     }
 
-    m_write_complete_callback = cb;
-    //SetWriteCompleteCallback(cb);
-    m_output_buffer.Append(data, len);
+    if (len == 0) {
+        // It is always ok to send 0-length data
+        if (cb)
+            m_event_loop->Defer(std::bind(std::move(cb), shared_from_this()));
+    }
+    return len;
+}
+
+void TcpConnection::WaitWritable(WriteCompleteCallback cb) {
+    m_write_complete_callback = std::move(cb);
     if (!m_eventor->Writing())
         m_eventor->EnableWriting();
-    return true;
+}
+
+void TcpConnection::SetWritevBatch(int iovecs) {
+    m_writev_batch = std::max(1, std::min(iovecs, ::cube::ChainBuffer::MAX_IOVECS));
+}
+
+void TcpConnection::SetBufferKeepCapacity(size_t bytes) {
+    m_keep_capacity = bytes;
+    UpdateKeepCapacity();
 }
 
 void TcpConnection::Close() {
@@ -173,6 +352,25 @@ void TcpConnection::DisableWriting() {
     m_eventor->DisableWriting();
 }
 
+bool TcpConnection::SetEdgeTriggered(bool on) {
+    m_event_loop->AssertInLoopThread();
+    if (Closed()) return false;
+    if (on && m_event_loop->PollerType() != Poller::Type_Epoll) return false;
+    if (m_edge_triggered == on) return true;
+
+    m_edge_triggered = on;
+    if (on) {
+        // keep POLLOUT registered, only edges are reported
+        m_eventor->EnableEdgeTriggered();
+        m_eventor->EnableWriting();
+    } else {
+        m_eventor->DisableEdgeTriggered();
+        if (m_state == ConnState_Connected && !OutputPending())
+            m_eventor->DisableWriting();
+    }
+    return true;
+}
+
 void TcpConnection::OnConnectionEstablished() {
     m_event_loop->AssertInLoopThread();
 
@@ -185,12 +383,18 @@ void TcpConnection::OnConnectionEstablished() {
 }
 
 void TcpConnection::OnRead() {
+    // a large ReadBytes is copied into the input buffer once complete
+    if (m_input_chain.ReadableBytes() > 0 && (!ReadingChained()
+                || m_input_buffer.ReadableBytes() + m_input_chain.ReadableBytes()
+                >= static_cast<size_t>(m_read_bytes)))
+        m_input_chain.RetrieveAllTo(&m_input_buffer);
+
     ReadCallback read_callback;
     if (m_read_bytes > 0 && static_cast<int>(m_input_buffer.ReadableBytes()) >= m_read_bytes) {
         // ReadAny or ReadBytes
         read_callback = std::move(m_read_callback);
         m_read_bytes = -1;
-    } else if (!m_read_delimiter.empty() && m_input_buffer.Find(m_read_delimiter) != NULL) {
+    } else if (!m_read_delimiter.empty() && FindReadDelimiter()) {
         // ReadUntil
         read_callback = std::move(m_read_callback);
         m_read_delimiter.clear();
@@ -200,23 +404,139 @@ void TcpConnection::OnRead() {
     return;
 }
 
+bool TcpConnection::FindReadDelimiter() {
+    // a delimiter may cross the end of last search,
+    // so search again its last delimiter.size() - 1 bytes.
+    // the input is only appended while ReadUntil is pending,
+    // start over if it is retrieved
+    size_t readable = m_input_buffer.ReadableBytes();
+    size_t overlap = m_read_delimiter.size() - 1;
+    size_t from = 0;
+    if (m_read_scanned <= readable && m_read_scanned > overlap)
+        from = m_read_scanned - overlap;
+    m_read_scanned = readable;
+    return FindDelimiter(m_read_delimiter, from);
+}
+
+ssize_t TcpConnection::ReadOnce(bool *short_read) {
+    size_t read_size = m_read_stats.read_size;
+    size_t room = 0;
+    size_t overflow = 0;
+    ssize_t nread = 0;
+    if (ReadingChained()) {
+        // read_size in new slabs, nothing is copied
+        size_t slab_size = m_event_loop->GetSlabPool()->SlabSize();
+        size_t slabs = std::min(std::max(read_size / slab_size, (size_t)1),
+                (size_t)::cube::ChainBuffer::MAX_READ_SLABS);
+        room = slabs * slab_size;
+        nread = m_input_chain.ReadFromFd(m_sock->Fd(), slabs);
+    } else {
+        // read into the reserved space directly, only what does not fit
+        // is copied from the overflow region
+        m_input_buffer.EnsureWritableBytes(read_size);
+        room = m_input_buffer.WritableBytes();
+        overflow = EventLoop::READ_OVERFLOW_SIZE;
+        nread = m_input_buffer.ReadFromFd(m_sock->Fd(),
+                m_event_loop->GetReadOverflow(), overflow);
+    }
+    m_read_stats.reads++;
+    *short_read = nread >= 0 && static_cast<size_t>(nread) < room + overflow;
+    if (nread < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK)
+            m_read_stats.empty_reads++;
+        return nread;
+    }
+    size_t n = nread;
+    m_read_stats.bytes += n;
+    if (overflow > 0 && n > room)
+        m_read_stats.overflow_bytes += n - room;
+
+    if (n >= room) {
+        m_read_stats.read_size = std::min(std::max(read_size, room) * 2, MAX_READ_SIZE);
+        m_small_reads = 0;
+    } else if (n < read_size / 2) {
+        if (++m_small_reads >= READ_SHRINK_AFTER) {
+            m_read_stats.read_size = std::max(read_size / 2, MIN_READ_SIZE);
+            m_small_reads = 0;
+        }
+    } else {
+        m_small_reads = 0;
+    }
+    if (m_read_stats.read_size != read_size)
+        UpdateKeepCapacity();
+    return nread;
+}
+
+void TcpConnection::UpdateKeepCapacity() {
+    // storage larger than a slab comes from the heap, keep it while
+    // reads are that large instead of allocating it for every read.
+    // it is freed on the next drain once the read size shrinks
+    size_t keep = m_keep_capacity;
+    size_t read_size = m_read_stats.read_size;
+    if (::cube::Buffer::CHEAP_PREPEND + read_size > m_event_loop->GetSlabPool()->SlabSize())
+        keep = std::max(keep, 2 * read_size);
+    m_input_buffer.SetKeepCapacity(keep);
+}
+
 void TcpConnection::HandleRead() {
     m_event_loop->AssertInLoopThread();
 
     if (Closed()) return;
 
-    ssize_t nread = m_input_buffer.ReadFromFd(m_sock->Fd());
-    if (nread < 0) {
-        // error
+    // level-triggered: one read per event
+    // edge-triggered: read until EAGAIN, at most MAX_IO_PER_EVENT times
+    // with read budget: read until EAGAIN or budget is used up
+    ssize_t total = 0;
+    bool eof = false;
+    bool error = false;
+    for (int reads = 0; ; ) {
+        bool short_read = false;
+        ssize_t nread = ReadOnce(&short_read);
+        if (nread > 0) {
+            total += nread;
+            if (m_read_budget > 0) {
+                if (static_cast<size_t>(total) >= m_read_budget) {
+                    // no more edge for pending data, continue in next iteration
+                    if (m_edge_triggered)
+                        m_event_loop->Post(std::bind(&TcpConnection::HandleRead, shared_from_this()));
+                    break;
+                }
+                // a short read drained the socket, skip the read of EAGAIN.
+                // edge-triggered mode still needs it to see eof
+                if (!m_edge_triggered && short_read)
+                    break;
+                continue;
+            }
+            if (!m_edge_triggered)
+                break;
+            if (++reads >= MAX_IO_PER_EVENT) {
+                // no more edge for pending data, continue in next iteration
+                m_event_loop->Post(std::bind(&TcpConnection::HandleRead, shared_from_this()));
+                break;
+            }
+        } else if (nread == 0) {
+            eof = true;
+            break;
+        } else if (errno == EINTR) {
+            continue;
+        } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            break;
+        } else {
+            error = true;
+            break;
+        }
+    }
+
+    if (total > 0)
+        OnRead();
+
+    if (Closed()) return;
+    if (error) {
         HandleError();
-        return;
-    } else if (nread == 0) {
+    } else if (eof) {
         // close by peer
         M_LOG_DEBUG("conn[%lu] closed by peer", Id());
         HandleClose();
-        return;
-    } else {
-        OnRead();
     }
 }
 
@@ -224,7 +544,7 @@ void TcpConnection::HandleEvents(int revents) {
     // prevent connection being destroyed in HandleXXXX()
     TcpConnectionPtr guard(shared_from_this());
 
-    m_last_active_time = TimeUtil::CurrentTime();
+    m_last_active_time = m_event_loop->NowMillis();
 
     if (revents & Poller::POLLERR) {
         HandleError();
@@ -241,7 +561,7 @@ void TcpConnection::HandleEvents(int revents) {
             assert(m_eventor->Writing());
             // async connect suss
             // disable writing when 
-            if (m_output_buffer.ReadableBytes() == 0) {
+            if (!m_edge_triggered && !OutputPending()) {
                 DisableWriting();
             }
             OnConnectionEstablished();
@@ -284,37 +604,89 @@ void TcpConnection::HandleWrite() {
     if (Closed()) return;
 
     // no data to write
-    if (m_output_buffer.ReadableBytes() == 0) {
-        DisableWriting();
+    if (!OutputPending()) {
+        if (!m_edge_triggered)
+            DisableWriting();
         return;
     }
 
-    //LOG_DEBUG("conn[%lu] writing!", Id());
-    int nwrote = ::write(m_eventor->Fd(),
-            m_output_buffer.Peek(),
-            m_output_buffer.ReadableBytes());
-    if (nwrote < 0) {
-        if (errno == EINTR) {
-            // it is ok.
-        } else if (errno == EWOULDBLOCK || errno == EAGAIN) {
-            // it is ok.
-        } else {
-            // error
-            HandleError();
-            return;
+    // level-triggered: one write per event
+    // edge-triggered: write until EAGAIN, at most MAX_IO_PER_EVENT times
+    for (int writes = 0; OutputPending(); ) {
+        //LOG_DEBUG("conn[%lu] writing!", Id());
+        ssize_t nwrote = WriteOutput();
+        if (nwrote < 0) {
+            if (errno == EINTR) {
+                // it is ok.
+                if (m_edge_triggered) continue;
+            } else if (errno == EWOULDBLOCK || errno == EAGAIN) {
+                // it is ok.
+            } else {
+                // error
+                HandleError();
+                return;
+            }
+            break;
+        }
+        if (!m_edge_triggered)
+            break;
+        if (++writes >= MAX_IO_PER_EVENT && OutputPending()) {
+            // socket may be still writable, no more edge will come
+            m_event_loop->Post(std::bind(&TcpConnection::HandleWrite, shared_from_this()));
+            break;
         }
-    } else {
-        m_output_buffer.Retrieve(nwrote);
     }
 
     // write completely
-    if (m_output_buffer.ReadableBytes() == 0) {
-        m_eventor->DisableWriting();
-        if (m_write_complete_callback)
-            m_write_complete_callback(shared_from_this());
+    if (!OutputPending()) {
+        if (!m_edge_triggered)
+            m_eventor->DisableWriting();
+        // one-shot, the callback may queue more writes with a new one
+        if (m_write_complete_callback) {
+            WriteCompleteCallback cb(std::move(m_write_complete_callback));
+            cb(shared_from_this());
+        }
     }
 }
 
+ssize_t TcpConnection::WriteOutput() {
+    int sockfd = m_eventor->Fd();
+    if (!m_pending_files) {
+        ssize_t nwrote = m_output_buffer.WriteToFd(sockfd, m_writev_batch);
+        if (nwrote > 0)
+            m_output_written += nwrote;
+        return nwrote;
+    }
+
+    // buffered data queued before the file goes first
+    PendingFile &file = m_pending_files->front();
+    if (m_output_written < file.position) {
+        ssize_t nwrote = m_output_buffer.WriteToFd(sockfd, m_writev_batch,
+                file.position - m_output_written);
+        if (nwrote > 0)
+            m_output_written += nwrote;
+        return nwrote;
+    }
+
+    ssize_t nsent = ::sendfile(sockfd, file.fd, &file.offset, file.len);
+    if (nsent == 0) {
+        // the file is shorter than expected
+        strings::FormatString(m_err_msg, "tcp connection[%lu] file ends with %zu bytes unsent",
+                Id(), file.len);
+        errno = EIO;
+        return -1;
+    }
+    if (nsent > 0) {
+        file.len -= nsent;
+        if (file.len == 0) {
+            m_pending_files->pop_front();
+            if (m_pending_files->empty())
+                m_pending_files.reset();
+        }
+    }
+    return nsent;
+}
+
 void TcpConnection::HandleClose() {
     m_event_loop->AssertInLoopThread();
 
@@ -325,17 +697,30 @@ void TcpConnection::HandleClose() {
     // remove events from poller
     m_eventor->Remove();
 
+    // give back slabs in loop thread, the connection may be
+    // destroyed in another thread. read callbacks deferred before
+    // closing still see the input buffer
+    m_input_chain.RetrieveAll();
+    m_output_buffer.RetrieveAll();
+    m_pending_files.reset();
+    m_event_loop->Defer(std::bind(&TcpConnection::ReleaseBuffers, shared_from_this()));
+
     TcpConnectionPtr guard(shared_from_this());
     m_connection_callback(guard);
 
     // prevent circular references
     m_connection_callback = std::bind(&DefaultConnectionCallback, std::placeholders::_1);
-    m_write_complete_callback = NULL;
-    m_read_callback = NULL;
+    m_write_complete_callback = nullptr;
+    m_read_callback = nullptr;
 
     m_close_callback(guard);
 }
 
+void TcpConnection::ReleaseBuffers() {
+    m_input_buffer.Release();
+    m_output_buffer.RetrieveAll();
+}
+
 void TcpConnection::HandleError() {
     m_event_loop->AssertInLoopThread();
     HandleClose();
@@ -1,9 +1,14 @@
 #ifndef __CUBE_TCP_CONNECTION_H__
 #define __CUBE_TCP_CONNECTION_H__
 
+#include <sys/types.h>
+#include <deque>
 #include <memory>
+#include <string>
 
 #include "base/buffer.h"
+#include "base/chain_buffer.h"
+#include "base/shared_slice.h"
 
 #include "callbacks.h"
 #include "inet_addr.h"
@@ -15,6 +20,80 @@ namespace net {
 class EventLoop;
 class Eventor;
 class Socket;
+class TcpConnection;
+
+// reads of a connection, bytes / reads is the bytes per read syscall
+struct TcpReadStats {
+    uint64_t reads;             // read syscalls
+    uint64_t empty_reads;       // reads got EAGAIN
+    uint64_t bytes;
+    uint64_t overflow_bytes;    // bytes copied from the overflow region of loop
+    size_t read_size;           // input buffer space reserved for next read
+};
+
+// awaitable reads and writes for coroutines, see net/coro/task.h.
+// await_suspend is a template on the coroutine handle,
+// so this header still builds without c++20.
+// when the connection is closed, the coroutine is resumed
+// in the same loop iteration with a failed result.
+class TcpAwaiter {
+    public:
+        explicit TcpAwaiter(TcpConnection *conn)
+            : m_conn(conn), m_buffer(NULL), m_done(false) {}
+
+    protected:
+        friend class TcpResumer;
+
+        TcpConnection *m_conn;
+        ::cube::Function<void()> m_resume;
+        ::cube::Buffer *m_buffer;
+        bool m_done;
+};
+
+// co_await returns the input buffer, or NULL when closed
+class ReadAwaiter : public TcpAwaiter {
+    public:
+        ReadAwaiter(TcpConnection *conn, size_t read_bytes, const std::string &delimiter)
+            : TcpAwaiter(conn), m_read_bytes(read_bytes), m_delimiter(delimiter) {}
+
+        bool await_ready();
+        template<typename Handle>
+        void await_suspend(Handle handle) {
+            m_resume = std::bind(&Handle::resume, handle);
+            Suspend();
+        }
+        ::cube::Buffer *await_resume() const { return m_buffer; }
+
+    private:
+        void Suspend();
+
+    private:
+        size_t m_read_bytes;
+        std::string m_delimiter;
+};
+
+// co_await returns true when all data is written,
+// false when closed or the completion is replaced by another write
+class WriteAwaiter : public TcpAwaiter {
+    public:
+        WriteAwaiter(TcpConnection *conn, const char *data, size_t len)
+            : TcpAwaiter(conn), m_data(data), m_len(len) {}
+
+        bool await_ready();
+        template<typename Handle>
+        void await_suspend(Handle handle) {
+            m_resume = std::bind(&Handle::resume, handle);
+            Suspend();
+        }
+        bool await_resume() const { return m_done; }
+
+    private:
+        void Suspend();
+
+    private:
+        const char *m_data;
+        size_t m_len;
+};
 
 class TcpConnection : public std::enable_shared_from_this<TcpConnection> {
     public:
@@ -24,6 +103,22 @@ class TcpConnection : public std::enable_shared_from_this<TcpConnection> {
             ConnState_Disconnected,
         };
 
+        // max reads or writes per event in edge-triggered mode,
+        // the rest is continued in next loop iteration
+        static const int MAX_IO_PER_EVENT = 16;
+        // input buffer space reserved before each read adapts to recent
+        // reads: doubled when a read fills it, halved after
+        // READ_SHRINK_AFTER reads in a row smaller than half of it
+        static const size_t MIN_READ_SIZE = 4 * 1024;
+        static const size_t MAX_READ_SIZE = 256 * 1024;
+        static const int READ_SHRINK_AFTER = 4;
+        // a ReadBytes of more bytes is read into slabs of the loop, and
+        // copied into the input buffer once when complete, so the buffer
+        // is not grown and copied again and again while it arrives
+        static const size_t CHAINED_READ_BYTES = MAX_READ_SIZE;
+        // smaller slices are copied into the output buffer
+        static const size_t MIN_SLICE_BYTES = 1024;
+
         TcpConnection(EventLoop *event_loop, int sockfd, const InetAddr &local_addr, const InetAddr &peer_addr);
         ~TcpConnection();
 
@@ -41,16 +136,45 @@ class TcpConnection : public std::enable_shared_from_this<TcpConnection> {
         void OnConnectionEstablished();
 
         // run callback when the read data's length >= read_bytes
-        void ReadBytes(size_t read_bytes, const ReadCallback &cb);
+        void ReadBytes(size_t read_bytes, ReadCallback cb);
         // run callback when the read data contains delimiter
-        void ReadUntil(const std::string &delimiter, const ReadCallback &cb);
+        void ReadUntil(const std::string &delimiter, ReadCallback cb);
         // run callback when the read data's length >= 1
-        void ReadAny(const ReadCallback &cb);
+        void ReadAny(ReadCallback cb);
+        // the delimiter found by the last ReadUntil, valid in its callback
+        // or after co_await until the input buffer is retrieved,
+        // so the caller need not search it again
+        const char *FoundDelimiter() { return m_input_buffer.Peek() + m_delimiter_offset; }
 
         bool Write(const std::string &str);
         bool Write(const char *data, size_t len);
-        bool Write(const std::string &str, const WriteCompleteCallback &cb);
-        bool Write(const char *data, size_t len, const WriteCompleteCallback &cb);
+        bool Write(const std::string &str, WriteCompleteCallback cb);
+        bool Write(const char *data, size_t len, WriteCompleteCallback cb);
+        // queue the slice without copying, e.g. a payload shared by many
+        // connections. it is flushed by writev with the data around it
+        bool Write(const ::cube::SharedSlice &slice);
+        bool Write(const ::cube::SharedSlice &slice, WriteCompleteCallback cb);
+
+        // send len bytes of file fd from offset with sendfile, in order
+        // with the data written before and after it, so file data never
+        // passes through user space. fd is not closed by the connection,
+        // keep it open until the write completes or the connection closes
+        bool WriteFile(int fd, off_t offset, size_t len);
+        bool WriteFile(int fd, off_t offset, size_t len, WriteCompleteCallback cb);
+
+        // iovecs per writev of pending output, 64 by default
+        void SetWritevBatch(int iovecs);
+
+        // awaitable versions for coroutines, e.g.
+        // Buffer *buffer = co_await conn->ReadUntil("\r\n\r\n");
+        // co_await them directly, they refer to their arguments
+        ReadAwaiter ReadBytes(size_t read_bytes) { return ReadAwaiter(this, read_bytes, std::string()); }
+        ReadAwaiter ReadUntil(const std::string &delimiter) { return ReadAwaiter(this, 0, delimiter); }
+        ReadAwaiter ReadAny() { return ReadBytes(1); }
+        // data is written before suspending, and never copied when it can be
+        // written directly
+        WriteAwaiter AsyncWrite(const std::string &str) { return WriteAwaiter(this, str.data(), str.length()); }
+        WriteAwaiter AsyncWrite(const char *data, size_t len) { return WriteAwaiter(this, data, len); }
 
         void Close();   // close the connection
         void CloseAfter(int64_t delay_ms);
@@ -61,7 +185,30 @@ class TcpConnection : public std::enable_shared_from_this<TcpConnection> {
         void EnableWriting();
         void DisableWriting();
 
-        time_t LastActiveTime() const { return m_last_active_time; }
+        // edge-triggered mode, reads and writes loop until EAGAIN,
+        // and POLLOUT stays registered instead of being toggled.
+        // return false when the poller does not support it (epoll only)
+        bool SetEdgeTriggered(bool on);
+        bool EdgeTriggered() const { return m_edge_triggered; }
+
+        // bytes read in one event at most, reads loop until EAGAIN or
+        // the budget is used up, the rest is continued in next iteration.
+        // 0 by default: one read per event in level-triggered mode,
+        // at most MAX_IO_PER_EVENT reads in edge-triggered mode.
+        // e.g. 1MB for bulk ingest connections
+        void SetReadBudget(size_t bytes) { m_read_budget = bytes; }
+        TcpReadStats GetReadStats() const { return m_read_stats; }
+
+        // input buffer storage kept when drained, larger storage goes
+        // back to the loop, see Buffer::SetKeepCapacity.
+        // 0 by default, so idle connections hold no buffer memory.
+        // while the read size is larger than a slab, storage of twice
+        // the read size is kept too, so bulk reads do not allocate it
+        // from the heap every time. output slabs always go back once written
+        void SetBufferKeepCapacity(size_t bytes);
+
+        // ms of the loop clock, see EventLoop::NowMillis()
+        int64_t LastActiveTime() const { return m_last_active_time; }
 
         const std::string &ErrMsg() const { return m_err_msg; }
 
@@ -70,10 +217,18 @@ class TcpConnection : public std::enable_shared_from_this<TcpConnection> {
         EventLoop *GetEventLoop() { return m_event_loop; }
 
         friend class Connector;
+        friend class ReadAwaiter;
+        friend class WriteAwaiter;
 
     private:
 
         void OnRead();
+        // search the delimiter of ReadUntil in the bytes read since last search
+        bool FindReadDelimiter();
+        // search delimiter in input from offset from, and remember where it is
+        bool FindDelimiter(const std::string &delimiter, size_t from);
+        // ReadUntil without searching the buffered bytes again
+        void WaitDelimiter(const std::string &delimiter, ReadCallback cb);
 
         void HandleEvents(int revents);
         int HandleConnect();
@@ -82,6 +237,27 @@ class TcpConnection : public std::enable_shared_from_this<TcpConnection> {
         void HandleError();
         void HandleClose();
 
+        void ReleaseBuffers();
+
+        // read once into the input buffer, and adapt the read size.
+        // short_read is set when the read did not fill the space offered
+        ssize_t ReadOnce(bool *short_read);
+        void UpdateKeepCapacity();
+        bool ReadingChained() const {
+            return m_read_bytes > 0 && static_cast<size_t>(m_read_bytes) > CHAINED_READ_BYTES;
+        }
+
+        // return the bytes left to queue, or -1 when closed,
+        // cb is deferred when nothing is left
+        ssize_t WriteDirectly(const char *data, size_t len, WriteCompleteCallback &cb);
+        void WaitWritable(WriteCompleteCallback cb);
+
+        bool OutputPending() const {
+            return m_output_buffer.ReadableBytes() > 0 || m_pending_files;
+        }
+        // write buffered data or a file once
+        ssize_t WriteOutput();
+
     private:
         // noncopyable
         TcpConnection(const TcpConnection &) = delete;
@@ -102,14 +278,41 @@ class TcpConnection : public std::enable_shared_from_this<TcpConnection> {
         InetAddr m_peer_addr;
 
         ConnState m_state;
+        bool m_edge_triggered;
 
+        // storage of buffers comes from the slab pool of the loop
         ::cube::Buffer m_input_buffer;
-        ::cube::Buffer m_output_buffer;
+        // rest of a large ReadBytes, see CHAINED_READ_BYTES
+        ::cube::ChainBuffer m_input_chain;
+        // written with writev
+        ::cube::ChainBuffer m_output_buffer;
+        int m_writev_batch;
+        // bytes of output buffer written ever
+        uint64_t m_output_written;
+
+        // file waiting for the buffered bytes before position
+        struct PendingFile {
+            int fd;
+            off_t offset;
+            size_t len;
+            uint64_t position;
+        };
+        // created by WriteFile and freed once the files are sent,
+        // so it is never empty, few connections send files
+        std::unique_ptr<std::deque<PendingFile> > m_pending_files;
 
         std::string m_read_delimiter;
+        // bytes of input buffer searched for m_read_delimiter
+        size_t m_read_scanned;
+        // offset from read index of the delimiter found by ReadUntil
+        size_t m_delimiter_offset;
         int m_read_bytes;
+        size_t m_read_budget;
+        int m_small_reads;
+        TcpReadStats m_read_stats;
+        size_t m_keep_capacity;
 
-        time_t m_last_active_time;
+        int64_t m_last_active_time;
 
         // callback when connection state changed
         ConnectionCallback m_connection_callback;
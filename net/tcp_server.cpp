@@ -1,6 +1,8 @@
+#include "base/count_downer.h"
 #include "base/logging.h"
 #include "tcp_server.h"
 #include "acceptor.h"
+#include "event_loop_thread_pool.h"
 #include "socket.h"
 
 using namespace std::placeholders;
@@ -11,17 +13,55 @@ namespace net {
 
 TcpServer::TcpServer(EventLoop *event_loop, const InetAddr &server_addr) 
     : m_event_loop(event_loop),
-    m_server_addr(server_addr) {
+    m_server_addr(server_addr),
+    m_thread_num(0),
+    m_poller_type(Poller::Type_Epoll),
+    m_load_balance(LoadBalance_RoundRobin),
+    m_reuse_port(false),
+    m_backlog(Acceptor::DEFAULT_BACKLOG),
+    m_edge_triggered(false),
+    m_read_budget(0),
+    m_numa_local(false),
+    m_next_loop_context(0) {
 }
 
 TcpServer::~TcpServer() {
 }
 
 bool TcpServer::Start() {
+    if (!m_reuse_port && !StartAcceptor())
+        return false;
+
+    m_thread_pool.reset(new EventLoopThreadPool(m_event_loop, m_thread_num));
+    m_thread_pool->SetThreadInitCallback(m_thread_init_callback);
+    m_thread_pool->SetPollerType(m_poller_type);
+    m_thread_pool->SetCpuAffinity(m_cpus);
+    m_thread_pool->SetNumaLocal(m_numa_local);
+    m_thread_pool->Start();
+
+    std::vector<EventLoop *> event_loops = m_thread_pool->GetLoops();
+    for (size_t i = 0; i < event_loops.size(); i++) {
+        std::unique_ptr<LoopContext> ctx(new LoopContext);
+        ctx->event_loop = event_loops[i];
+        // base loop serves connections when there is no io thread
+        ctx->cpu = m_thread_num > 0 ? m_thread_pool->GetLoopCpu(i) : -1;
+        ctx->conns_num = 0;
+        m_loop_contexts.push_back(std::move(ctx));
+    }
+
+    if (m_reuse_port && !StartAcceptors()) {
+        Stop();
+        return false;
+    }
+    return true;
+}
+
+bool TcpServer::StartAcceptor() {
     m_acceptor.reset(new Acceptor(
                 m_event_loop,
                 m_server_addr,
                 std::bind(&TcpServer::OnAccept, this, _1)));
+    m_acceptor->SetBacklog(m_backlog);
     
     bool ret = m_acceptor->Listen();
     if (!ret) {
@@ -31,44 +71,157 @@ bool TcpServer::Start() {
     return ret;
 }
 
+bool TcpServer::StartAcceptors() {
+    // acceptors must listen in their own loop threads
+    CountDowner count_downer(m_loop_contexts.size());
+    for (size_t i = 0; i < m_loop_contexts.size(); i++) {
+        LoopContext *ctx = m_loop_contexts[i].get();
+        ctx->event_loop->RunInLoop(std::bind(&TcpServer::StartAcceptorInLoop, this, ctx, &count_downer));
+    }
+    count_downer.Wait();
+
+    for (size_t i = 0; i < m_loop_contexts.size(); i++) {
+        if (!m_loop_contexts[i]->acceptor) {
+            m_err_msg = m_loop_contexts[i]->err_msg;
+            return false;
+        }
+    }
+    return true;
+}
+
+void TcpServer::StartAcceptorInLoop(LoopContext *ctx, CountDowner *count_downer) {
+    ctx->event_loop->AssertInLoopThread();
+
+    ctx->acceptor.reset(new Acceptor(
+                ctx->event_loop,
+                m_server_addr,
+                std::bind(&TcpServer::OnAcceptInLoop, this, ctx, _1)));
+    ctx->acceptor->SetBacklog(m_backlog);
+    ctx->acceptor->SetReusePort(true);
+    ctx->acceptor->SetIncomingCpu(ctx->cpu);
+
+    if (!ctx->acceptor->Listen()) {
+        ctx->err_msg = ctx->acceptor->ErrMsg();
+        ctx->acceptor.reset();
+    }
+    count_downer->CountDown();
+}
+
 void TcpServer::Stop() {
     // stop the acceptor
-    m_acceptor->Stop();
+    if (m_acceptor)
+        m_acceptor->Stop();
+
+    // stop acceptors and close connections in their own loop threads,
+    // io loops will exit after that
+    for (size_t i = 0; i < m_loop_contexts.size(); i++) {
+        LoopContext *ctx = m_loop_contexts[i].get();
+        ctx->event_loop->RunInLoop(std::bind(&TcpServer::StopInLoop, this, ctx));
+    }
+    if (m_thread_pool)
+        m_thread_pool->Stop();
 
     m_event_loop->Stop();
 }
 
+TcpServer::LoopContext *TcpServer::GetNextLoopContext(int sockfd) {
+    assert(!m_loop_contexts.empty());
+
+    if (m_load_balance == LoadBalance_IncomingCpu) {
+        // loops share a cpu when there are fewer cpus than loops,
+        // take the one with least connections among them
+        int cpu = sockets::GetIncomingCpu(sockfd);
+        LoopContext *least = NULL;
+        for (size_t i = 0; cpu >= 0 && i < m_loop_contexts.size(); i++) {
+            LoopContext *ctx = m_loop_contexts[i].get();
+            if (ctx->cpu == cpu && (least == NULL || ctx->conns_num < least->conns_num))
+                least = ctx;
+        }
+        if (least != NULL)
+            return least;
+    }
+
+    if (m_load_balance == LoadBalance_LeastConnections) {
+        LoopContext *least = m_loop_contexts[0].get();
+        for (size_t i = 1; i < m_loop_contexts.size(); i++) {
+            if (m_loop_contexts[i]->conns_num < least->conns_num)
+                least = m_loop_contexts[i].get();
+        }
+        return least;
+    }
+
+    // round robin
+    LoopContext *ctx = m_loop_contexts[m_next_loop_context].get();
+    if (++m_next_loop_context >= m_loop_contexts.size())
+        m_next_loop_context = 0;
+    return ctx;
+}
+
 void TcpServer::OnAccept(int sockfd) {
+    LoopContext *ctx = GetNextLoopContext(sockfd);
+    ctx->conns_num++;
+
+    // create the connection in its io loop thread
+    ctx->event_loop->RunInLoop(std::bind(&TcpServer::NewConnection, this, ctx, sockfd));
+}
+
+void TcpServer::OnAcceptInLoop(LoopContext *ctx, int sockfd) {
+    ctx->conns_num++;
+    NewConnection(ctx, sockfd);
+}
+
+void TcpServer::NewConnection(LoopContext *ctx, int sockfd) {
+    ctx->event_loop->AssertInLoopThread();
+
     // new connection
     InetAddr local_addr(sockets::GetLocalAddr(sockfd));
     InetAddr peer_addr(sockets::GetPeerAddr(sockfd));
     TcpConnectionPtr conn(new TcpConnection(
-                m_event_loop,
+                ctx->event_loop,
                 sockfd,
                 local_addr,
                 peer_addr));
 
-    // put conn into conns map
-    // TODO: thread-safety
-    m_conns_map[conn->Id()] = conn;
+    // put conn into conns map of its io loop
+    ctx->conns_map[conn->Id()] = conn;
     M_LOG_INFO("New Connection[%lu] in TcpServer localAddr[%s], peerAddr[%s]",
             conn->Id(), local_addr.IpPort().c_str(), peer_addr.IpPort().c_str());
 
     conn->SetConnectionCallback(m_connection_callback);
-    conn->SetCloseCallback(std::bind(&TcpServer::RemoveConnection, this, std::placeholders::_1));
+    conn->SetCloseCallback(std::bind(&TcpServer::RemoveConnection, this, ctx, _1));
+    if (m_edge_triggered && !conn->SetEdgeTriggered(true)) {
+        M_LOG_WARN("conn[%lu] edge-triggered mode is not supported by poller", conn->Id());
+    }
+    conn->SetReadBudget(m_read_budget);
 
-    // make sure to call OnConnectionEstablished in loop-thread
-    conn->GetEventLoop()->Post(std::bind(&TcpConnection::OnConnectionEstablished, conn));
+    conn->OnConnectionEstablished();
 }
 
-void TcpServer::RemoveConnection(TcpConnectionPtr conn) {
+void TcpServer::RemoveConnection(LoopContext *ctx, TcpConnectionPtr conn) {
+    ctx->event_loop->AssertInLoopThread();
+
     M_LOG_TRACE("Remove Connection[%lu] in TcpServer local_addr[%s], peerAddr[%s]",
             conn->Id(),
             conn->LocalAddr().IpPort().c_str(),
             conn->PeerAddr().IpPort().c_str());
 
-    // TODO: thread-safety
-    m_conns_map.erase(conn->Id());
+    if (ctx->conns_map.erase(conn->Id()))
+        ctx->conns_num--;
+}
+
+void TcpServer::StopInLoop(LoopContext *ctx) {
+    ctx->event_loop->AssertInLoopThread();
+
+    if (ctx->acceptor) {
+        ctx->acceptor->Stop();
+        ctx->acceptor.reset();
+    }
+
+    // Close() removes conn from conns_map, so iterate a copy
+    std::map<uint64_t, TcpConnectionPtr> conns_map = ctx->conns_map;
+    for (auto it = conns_map.begin(); it != conns_map.end(); it++) {
+        it->second->Close();
+    }
 }
 
 }
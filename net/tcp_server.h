@@ -3,14 +3,19 @@
 
 #include <memory>
 #include <map>
+#include <vector>
+#include <atomic>
 
 #include "callbacks.h"
 #include "inet_addr.h"
 #include "event_loop.h"
+#include "event_loop_thread_pool.h"
 #include "tcp_connection.h"
 
 namespace cube {
 
+class CountDowner;
+
 namespace net {
 
 class EventLoop;
@@ -19,6 +24,15 @@ class Acceptor;
 // combine it into your class and provide a ConnectionCallback
 class TcpServer {
     public:
+        enum LoadBalance {
+            LoadBalance_RoundRobin,
+            LoadBalance_LeastConnections,
+            // the loop pinned to the cpu which received the connection,
+            // see SetCpuAffinity, the one with least connections if loops
+            // share the cpu, round robin if there is no such loop
+            LoadBalance_IncomingCpu,
+        };
+
         TcpServer(EventLoop *event_loop, const InetAddr &server_addr);
         ~TcpServer();
 
@@ -26,6 +40,32 @@ class TcpServer {
         void SetConnectionCallback(const ConnectionCallback &cb) 
         { m_connection_callback = cb; }
 
+        // number of io threads, must be called before Start()
+        // 0 means all connections are served in event_loop (default)
+        // otherwise, callbacks are invoked in io threads
+        void SetThreadNum(size_t thread_num) { m_thread_num = thread_num; }
+        // run in each io thread before looping
+        void SetThreadInitCallback(const EventLoopThreadPool::ThreadInitCallback &cb)
+        { m_thread_init_callback = cb; }
+        // poller backend of io loops
+        void SetPollerType(Poller::Type poller_type) { m_poller_type = poller_type; }
+        // pin io loop i to cpus[i % cpus.size()], see EventLoopThreadPool
+        void SetCpuAffinity(const std::vector<int> &cpus) { m_cpus = cpus; }
+        // allocate memory of io threads from their local numa node
+        void SetNumaLocal(bool on) { m_numa_local = on; }
+        // how to choose an io loop for new connection
+        void SetLoadBalance(LoadBalance load_balance) { m_load_balance = load_balance; }
+        // each io loop owns a SO_REUSEPORT acceptor, and accepts its own connections.
+        // LoadBalance is ignored, kernel distributes connections,
+        // with SetCpuAffinity each acceptor sets SO_INCOMING_CPU to its cpu
+        void SetReusePort(bool on) { m_reuse_port = on; }
+        // serve new connections in edge-triggered mode, see TcpConnection::SetEdgeTriggered
+        void SetEdgeTriggered(bool on) { m_edge_triggered = on; }
+        // read budget of new connections, see TcpConnection::SetReadBudget
+        void SetReadBudget(size_t bytes) { m_read_budget = bytes; }
+        // listen backlog, Acceptor::DEFAULT_BACKLOG by default
+        void SetBacklog(int backlog) { m_backlog = backlog; }
+
         bool Start();
         void Stop();
 
@@ -33,9 +73,29 @@ class TcpServer {
 
         const std::string &ErrMsg() const { return m_err_msg; }
     private:
+        // connections served by one io loop,
+        // conns_map is only accessed in its loop thread
+        struct LoopContext {
+            EventLoop *event_loop;
+            int cpu;    // -1 if not pinned
+            std::atomic<size_t> conns_num;
+            std::map<uint64_t, TcpConnectionPtr> conns_map;
+            // only for reuse port mode
+            std::unique_ptr<Acceptor> acceptor;
+            std::string err_msg;
+        };
+
+        bool StartAcceptor();
+        bool StartAcceptors();
+        void StartAcceptorInLoop(LoopContext *ctx, CountDowner *count_downer);
+
         void OnAccept(int sockfd);
+        void OnAcceptInLoop(LoopContext *ctx, int sockfd);
+        LoopContext *GetNextLoopContext(int sockfd);
 
-        void RemoveConnection(TcpConnectionPtr conn);
+        void NewConnection(LoopContext *ctx, int sockfd);
+        void RemoveConnection(LoopContext *ctx, TcpConnectionPtr conn);
+        void StopInLoop(LoopContext *ctx);
 
     private:
         EventLoop *m_event_loop;
@@ -44,10 +104,22 @@ class TcpServer {
 
         std::unique_ptr<Acceptor> m_acceptor;
 
+        size_t m_thread_num;
+        Poller::Type m_poller_type;
+        LoadBalance m_load_balance;
+        bool m_reuse_port;
+        int m_backlog;
+        bool m_edge_triggered;
+        size_t m_read_budget;
+        std::vector<int> m_cpus;
+        bool m_numa_local;
+        std::unique_ptr<EventLoopThreadPool> m_thread_pool;
+        EventLoopThreadPool::ThreadInitCallback m_thread_init_callback;
+        std::vector<std::unique_ptr<LoopContext> > m_loop_contexts;
+        size_t m_next_loop_context;
+
         ConnectionCallback m_connection_callback;
         std::string m_err_msg;
-
-        std::map<uint64_t, TcpConnectionPtr> m_conns_map;
 };
 
 }
@@ -262,6 +262,40 @@ int RedisClient::MultiExec(const RedisReplyCallback &callback,
     return CUBE_OK;
 }
 
+// hiredis frees the reply after callback, so keep a copy
+static void SetReply(::cube::Promise<RedisReply> &promise, redisReply *reply) {
+    promise.SetValue(RedisReply(reply));
+}
+
+::cube::Future<RedisReply> RedisClient::Exec(int64_t timeout_ms, const char *format, ...) {
+    ::cube::Promise<RedisReply> promise;
+    ::cube::Future<RedisReply> future = promise.GetFuture();
+
+    va_list ap;
+    va_start(ap, format);
+    int status = Exec(std::bind(&SetReply, promise, _1), timeout_ms, format, ap);
+    va_end(ap);
+    if (status != CUBE_OK)
+        promise.SetValue(RedisReply());
+    return future;
+}
+
+::cube::Future<RedisReply> RedisClient::Exec(int64_t timeout_ms, const RedisCommand &cmd) {
+    ::cube::Promise<RedisReply> promise;
+    ::cube::Future<RedisReply> future = promise.GetFuture();
+    if (Exec(std::bind(&SetReply, promise, _1), timeout_ms, cmd) != CUBE_OK)
+        promise.SetValue(RedisReply());
+    return future;
+}
+
+::cube::Future<RedisReply> RedisClient::MultiExec(int64_t timeout_ms, const RedisCommands &cmds) {
+    ::cube::Promise<RedisReply> promise;
+    ::cube::Future<RedisReply> future = promise.GetFuture();
+    if (MultiExec(std::bind(&SetReply, promise, _1), timeout_ms, cmds) != CUBE_OK)
+        promise.SetValue(RedisReply());
+    return future;
+}
+
 void RedisClient::OnDisconnect(RedisConnectionPtr conn) {
     auto it = m_idle_conns.find(conn->PeerAddr().IpPort());
     if (it == m_idle_conns.end())
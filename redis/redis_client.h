@@ -4,8 +4,10 @@
 #include <vector>
 #include <map>
 
+#include "base/future.h"
 #include "redis_connection.h"
 #include "redis_command.h"
+#include "redis_reply.h"
 
 namespace cube {
 
@@ -39,6 +41,12 @@ class RedisClient {
         int MultiExec(const RedisReplyCallback &callback,
                 int64_t timeout_ms, const RedisCommands &cmds);
 
+        // same as above, but return a future of the reply,
+        // which must be used in the thread of event_loop
+        ::cube::Future<RedisReply> Exec(int64_t timeout_ms, const char *format, ...);
+        ::cube::Future<RedisReply> Exec(int64_t timeout_ms, const RedisCommand &cmd);
+        ::cube::Future<RedisReply> MultiExec(int64_t timeout_ms, const RedisCommands &cmds);
+
     private:
         const ::cube::net::InetAddr &GetNextAddr();
         RedisConnectionPtr GetConn();
@@ -0,0 +1,26 @@
+// hiredis headers
+#include "hiredis.h"
+
+#include "redis_reply.h"
+
+namespace cube {
+
+namespace redis {
+
+RedisReply::RedisReply(const redisReply *reply)
+    : m_type(0), m_integer(0) {
+    if (reply == NULL)
+        return;
+
+    m_type = reply->type;
+    m_integer = reply->integer;
+    if (reply->str != NULL)
+        m_str.assign(reply->str, reply->len);
+    m_elements.reserve(reply->elements);
+    for (size_t i = 0; i < reply->elements; i++)
+        m_elements.push_back(RedisReply(reply->element[i]));
+}
+
+}
+
+}
@@ -0,0 +1,42 @@
+#ifndef __CUBE_REDIS_REPLY_H__
+#define __CUBE_REDIS_REPLY_H__
+
+#include <string>
+#include <vector>
+
+struct redisReply;
+
+namespace cube {
+
+namespace redis {
+
+// copy of a redisReply, which is freed by hiredis after the reply callback.
+// used as the value of futures returned by RedisClient
+class RedisReply {
+
+public:
+    RedisReply() : m_type(0), m_integer(0) {}
+    explicit RedisReply(const redisReply *reply);
+
+    // false when there is no reply, the command failed or timed out
+    bool Valid() const { return m_type != 0; }
+
+    // REDIS_REPLY_*
+    int Type() const { return m_type; }
+    long long Integer() const { return m_integer; }
+    // string, status or error
+    const std::string &Str() const { return m_str; }
+    const std::vector<RedisReply> &Elements() const { return m_elements; }
+
+private:
+    int m_type;
+    long long m_integer;
+    std::string m_str;
+    std::vector<RedisReply> m_elements;
+};
+
+}
+
+}
+
+#endif